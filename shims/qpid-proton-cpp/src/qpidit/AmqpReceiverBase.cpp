@@ -21,26 +21,253 @@
 
 #include "qpidit/AmqpReceiverBase.hpp"
 
+#include <json/json.h>
 #include <sstream>
+#include <proton/connection.hpp>
 #include <proton/container.hpp>
+#include <proton/delivery.hpp>
+#include <proton/message.hpp>
 #include <proton/receiver.hpp>
+#include <proton/receiver_options.hpp>
 #include <proton/thread_safe.hpp> // for proton::returned<>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
 
+    // --- AmqpReceiverBase::AckTimer ---
+
+    AmqpReceiverBase::AckTimer::AckTimer(AmqpReceiverBase& receiver) : _receiver(receiver) {}
+
+    void AmqpReceiverBase::AckTimer::operator()() {
+        _receiver.onAckTimer();
+    }
+
+
+    // --- AmqpReceiverBase ---
+
+    //static
+    const uint32_t AmqpReceiverBase::s_defaultPrefetch = 10;
+
     AmqpReceiverBase::AmqpReceiverBase(const std::string& testName,
                                        const std::string& brokerAddr,
                                        const std::string& queueName):
-                    AmqpTestBase(testName, brokerAddr, queueName)
+                    AmqpTestBase(testName, brokerAddr, queueName),
+                    _msgsReceived(0),
+                    _latencyFlag(false),
+                    _latencyHistogram(),
+                    _jsonLinesFlag(false),
+                    _resultKeyPrinted(false),
+                    _resultValueList(Json::arrayValue),
+                    _prefetch(0),
+                    _creditBatch(0),
+                    _creditBytes(0),
+                    _maxMessageBytes(0),
+                    _ackBatch(0),
+                    _ackIntervalMs(0),
+                    _unaccepted(),
+                    _ackTimer(*this),
+                    _container(0),
+                    _receiver(),
+                    _listenFlag(false),
+                    _listener()
     {}
 
     AmqpReceiverBase::~AmqpReceiverBase() {}
 
+    void AmqpReceiverBase::openLink(proton::connection& c) {
+        c.open_receiver(_queueName, receiverOptions().handler(*this));
+        ++_linksOpen;
+    }
+
+    uint32_t AmqpReceiverBase::msgsReceived() const {
+        return __atomic_load_n(&_msgsReceived, __ATOMIC_SEQ_CST);
+    }
+
+    void AmqpReceiverBase::setOptions(const ShimArgs& args) {
+        AmqpTestBase::setOptions(args);
+        if (args.hasOption("latency")) _latencyFlag = true;
+        if (args.hasOption("json-lines")) _jsonLinesFlag = true;
+        _prefetch = args.getUintOption("prefetch", _prefetch);
+        _creditBatch = args.getUintOption("credit-batch", _creditBatch);
+        _creditBytes = args.getUintOption("credit-bytes", _creditBytes);
+        _ackBatch = args.getUintOption("ack-batch", _ackBatch);
+        _ackIntervalMs = args.getUintOption("ack-interval", _ackIntervalMs);
+        if (args.hasOption("listen")) _listenFlag = true;
+        if (_listenFlag && args.hasOption("server")) {
+            // A persistent shim server connects to the broker itself
+            throw qpidit::ArgumentError("Option --listen cannot be combined with --server");
+        }
+        if (_listenFlag && _numThreads > 1) {
+            // Accepted connections would be handled on different threads, but the receiver's state is not locked
+            throw qpidit::ArgumentError("Option --listen cannot be combined with --threads");
+        }
+        if (_ackIntervalMs > 0 && _numThreads > 1) {
+            // Timer tasks are not serialized with the connection's events on a multi-threaded container
+            throw qpidit::ArgumentError("Option --ack-interval cannot be combined with --threads");
+        }
+    }
+
     void AmqpReceiverBase::on_container_start(proton::container &c) {
+        if (_listenFlag) {
+            _listener = c.listen(_brokerAddr);
+            reportProgress(0); // The sender may now connect
+            return;
+        }
         std::ostringstream oss;
         oss << _brokerAddr << "/" << _queueName;
-        c.open_receiver(oss.str());
+        c.open_receiver(oss.str(), receiverOptions());
+    }
+
+    void AmqpReceiverBase::on_receiver_open(proton::receiver &r) {
+        if (r.uninitialized()) {
+            // Link opened by the peer (eg a sender connected directly rather than through a broker)
+            r.open(receiverOptions());
+        }
+        if (manualCredit()) {
+            r.add_credit(creditLimit());
+        }
+        if (_ackIntervalMs > 0 && _container == 0) {
+            _container = &r.connection().container();
+            _receiver = r;
+            _container->schedule(proton::duration(_ackIntervalMs), _ackTimer);
+        }
+    }
+
+    void AmqpReceiverBase::on_message(proton::delivery &d, proton::message &m) {
+        reportProgress(__atomic_add_fetch(&_msgsReceived, 1, __ATOMIC_SEQ_CST));
+        if (_latencyFlag) {
+            recordLatency(m);
+        }
+        if (manualAccept()) {
+            // Held before processing, so that it is accepted by flushLink() if this message completes the test
+            _unaccepted.push_back(d);
+        }
+        processMessage(d, m);
+        if (_complete && _listenFlag) {
+            _listener.stop(); // Otherwise the container keeps running, waiting for more connections
+        }
+        if (_ackBatch > 0 && !_complete && _unaccepted.size() >= _ackBatch) {
+            acceptDeliveries();
+        }
+        if (manualCredit() && !_complete) {
+            proton::receiver r = d.receiver();
+            replenishCredit(r);
+        }
+    }
+
+    // protected
+
+    bool AmqpReceiverBase::manualAccept() const {
+        return _ackBatch > 0 || _ackIntervalMs > 0;
+    }
+
+    void AmqpReceiverBase::acceptDeliveries() {
+        // Settled together in delivery order, proton coalesces these into one disposition for the whole range
+        for (std::vector<proton::delivery>::iterator i=_unaccepted.begin(); i!=_unaccepted.end(); ++i) {
+            i->accept();
+        }
+        _unaccepted.clear();
+    }
+
+    void AmqpReceiverBase::flushLink(proton::link&) {
+        acceptDeliveries();
+    }
+
+    void AmqpReceiverBase::onAckTimer() {
+        // Stop once the test is complete or has failed and closed its link
+        if (_complete || !_receiver.active()) return;
+        acceptDeliveries();
+        _container->schedule(proton::duration(_ackIntervalMs), _ackTimer);
+    }
+
+    bool AmqpReceiverBase::manualCredit() const {
+        return _creditBatch > 0 || _creditBytes > 0;
+    }
+
+    proton::receiver_options AmqpReceiverBase::receiverOptions() const {
+        proton::receiver_options opts;
+        if (manualAccept()) {
+            opts.auto_accept(false);
+        }
+        if (manualCredit()) {
+            opts.credit_window(0);
+        } else if (_prefetch > 0) {
+            opts.credit_window(_prefetch);
+        }
+        return opts;
+    }
+
+    uint32_t AmqpReceiverBase::creditLimit() const {
+        if (_creditBytes > 0) {
+            if (_maxMessageBytes == 0) return 1;
+            uint64_t limit = _creditBytes / _maxMessageBytes;
+            if (limit == 0) limit = 1;
+            if (_prefetch > 0 && limit > _prefetch) limit = _prefetch;
+            return limit < 0x7fffffff ? uint32_t(limit) : 0x7fffffff;
+        }
+        if (_prefetch > 0) return _prefetch;
+        // Leave room for a batch to be issued while the previous one is still in use
+        return 2 * _creditBatch > s_defaultPrefetch ? 2 * _creditBatch : s_defaultPrefetch;
+    }
+
+    void AmqpReceiverBase::replenishCredit(proton::receiver& r) {
+        const uint32_t limit = creditLimit();
+        const int credit = r.credit();
+        if (credit >= int(limit)) return;
+        const uint32_t deficit = limit - credit;
+        const uint32_t batch = _creditBatch > 0 ? _creditBatch : (limit + 1) / 2;
+        if (credit == 0 || deficit >= batch) {
+            r.add_credit(deficit);
+        }
+    }
+
+    void AmqpReceiverBase::recordMessageSize(uint64_t bytes) {
+        if (bytes > _maxMessageBytes) _maxMessageBytes = bytes;
+    }
+
+    void AmqpReceiverBase::addResultValue(const std::string& resultKey, const Json::Value& value) {
+        if (_jsonLinesFlag) {
+            std::ostream& out = resultStream();
+            if (!_resultKeyPrinted) {
+                out << resultKey << std::endl;
+                _resultKeyPrinted = true;
+            }
+            Json::Value record(Json::objectValue);
+            record["value"] = value;
+            Json::FastWriter fw;
+            out << fw.write(record) << std::flush;
+        } else {
+            _resultValueList.append(value);
+        }
+    }
+
+    void AmqpReceiverBase::printResultValues(std::ostream& out, const std::string& resultKey) {
+        if (_jsonLinesFlag) {
+            if (!_resultKeyPrinted) {
+                out << resultKey << std::endl;
+                _resultKeyPrinted = true;
+            }
+        } else {
+            out << resultKey << std::endl;
+            Json::FastWriter fw;
+            out << fw.write(_resultValueList);
+        }
+    }
+
+    void AmqpReceiverBase::recordLatency(const proton::message& m) {
+        if (m.message_annotations().exists(s_sendTimeAnnotation)) {
+            const int64_t latencyNs = nowNs() - proton::get<int64_t>(m.message_annotations().get(s_sendTimeAnnotation));
+            _latencyHistogram.record(latencyNs > 0 ? latencyNs : 0);
+        }
+    }
+
+    void AmqpReceiverBase::printLatency(std::ostream& out) {
+        if (_latencyFlag) {
+            Json::FastWriter fw;
+            out << fw.write(_latencyHistogram.toJson());
+        }
     }
 
 } // namespace qpidit
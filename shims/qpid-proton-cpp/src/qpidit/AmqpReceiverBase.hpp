@@ -22,21 +22,116 @@
 #ifndef SRC_QPIDIT_AMQPRECEIVERBASE_HPP_
 #define SRC_QPIDIT_AMQPRECEIVERBASE_HPP_
 
+#include <json/value.h>
+#include <proton/delivery.hpp>
+#include <proton/function.hpp>
+#include <proton/listener.hpp>
 #include <proton/messaging_handler.hpp>
+#include <proton/receiver.hpp>
+#include <proton/receiver_options.hpp>
 #include <qpidit/AmqpTestBase.hpp>
+#include <qpidit/LatencyHistogram.hpp>
+#include <vector>
 
 namespace qpidit
 {
 
+    /*
+     * Base class for AMQP receivers. Derived classes handle each message in processMessage(). When the
+     * --latency option is set, the send-to-receive latency of each message carrying a send time annotation
+     * (see AmqpSenderBase --timestamp) is recorded, and printed by printLatency().
+     *
+     * Derived classes which return one result value per message add them through addResultValue(). Normally
+     * these are collected into a JSON list printed once the test is complete. With the --json-lines option,
+     * each value is instead printed as soon as it is received, as a {"value": <value>} JSON line following a
+     * line containing the result key, so that memory use does not grow with the number of messages and a
+     * partial result is available if the test is killed.
+     *
+     * Link credit is controlled by these options:
+     *   --prefetch=N      Credit window kept topped up automatically by proton (proton's default is 10).
+     *   --credit-batch=B  Issue credit manually, B at a time once B deliveries have used it up. The window
+     *                     is --prefetch if given, otherwise 2 * B.
+     *   --credit-bytes=M  Issue credit manually, limited so that M bytes of the largest message seen so far
+     *                     (as reported by derived classes through recordMessageSize()) can be outstanding.
+     *                     A single credit is issued until a message size is known. Also capped by --prefetch.
+     * Derived classes may set defaults for these in their constructor.
+     *
+     * Deliveries are accepted automatically by proton unless --ack-batch=N or --ack-interval=T is given, in
+     * which case they are accepted together once N are waiting or every T ms, and when the test is complete.
+     * Proton writes consecutive deliveries settled with the same outcome as one ranged disposition, so each
+     * batch costs the sender a single disposition frame rather than one per message.
+     *
+     * With --listen, the receiver connects to nothing: it listens on the broker address instead, and receives
+     * from the links of any sender which connects to it directly. Once listening it reports progress (see
+     * AmqpTestBase --progress-fd) of 0 messages, so that the test program knows when to start the sender.
+     *
+     * Otherwise the receiver has a single connection, so its events are never handled concurrently and its
+     * state needs no locking. As a listening receiver may accept several connections, --listen cannot be
+     * combined with --threads.
+     */
     class AmqpReceiverBase : public AmqpTestBase
     {
+    protected:
+        class AckTimer : public proton::void_function0
+        {
+        protected:
+            AmqpReceiverBase& _receiver;
+        public:
+            AckTimer(AmqpReceiverBase& receiver);
+            void operator()();
+        };
+
+        uint32_t _msgsReceived; // Updated atomically, so that msgsReceived() may be called from any thread
+        bool _latencyFlag;
+        LatencyHistogram _latencyHistogram;
+        bool _jsonLinesFlag; // Print result values as they are received (--json-lines)
+        bool _resultKeyPrinted;
+        Json::Value _resultValueList; // Result values, when not printed as they are received
+        uint32_t _prefetch; // Credit window, 0 for proton's default (--prefetch)
+        uint32_t _creditBatch; // Manual credit batch size, 0 for half the window (--credit-batch)
+        uint32_t _creditBytes; // Memory budget for manual credit, 0 for none (--credit-bytes)
+        uint64_t _maxMessageBytes; // Largest message size reported by recordMessageSize()
+        uint32_t _ackBatch; // Accept deliveries once this many are waiting, 0 for no batching (--ack-batch)
+        uint32_t _ackIntervalMs; // Accept waiting deliveries at this interval, 0 for none (--ack-interval)
+        std::vector<proton::delivery> _unaccepted; // In delivery order, so that a batch forms a single range
+        AckTimer _ackTimer;
+        proton::container* _container; // For rescheduling _ackTimer
+        proton::receiver _receiver; // Link whose deliveries _ackTimer accepts
+        bool _listenFlag; // Accept connections on _brokerAddr rather than connecting to it (--listen)
+        proton::listener _listener;
     public:
         AmqpReceiverBase(const std::string& testName,
                          const std::string& brokerAddr,
                          const std::string& queueName);
         virtual ~AmqpReceiverBase();
 
+        void openLink(proton::connection& c);
+        uint32_t msgsReceived() const;
+        void setOptions(const ShimArgs& args);
         void on_container_start(proton::container &c);
+        void on_receiver_open(proton::receiver &r);
+        void on_message(proton::delivery &d, proton::message &m);
+
+    protected:
+        static const uint32_t s_defaultPrefetch; // Same as proton's default credit window
+
+        bool manualAccept() const;
+        void acceptDeliveries();
+        void flushLink(proton::link& l);
+        void onAckTimer();
+        bool manualCredit() const;
+        proton::receiver_options receiverOptions() const;
+        uint32_t creditLimit() const;
+        void replenishCredit(proton::receiver& r);
+        void recordMessageSize(uint64_t bytes);
+
+        virtual void processMessage(proton::delivery &d, proton::message &m) = 0;
+        void addResultValue(const std::string& resultKey, const Json::Value& value);
+        // Print the result key and any result values not already printed
+        void printResultValues(std::ostream& out, const std::string& resultKey);
+        void recordLatency(const proton::message& m);
+        // Print the latency summary as a JSON line if latency is being recorded
+        void printLatency(std::ostream& out);
     };
 
 } // namespace qpidit
@@ -21,14 +21,25 @@
 
 #include "qpidit/AmqpSenderBase.hpp"
 
+#include <json/json.h>
+#include <iostream>
 #include <sstream>
+#include <proton/connection.hpp>
 #include <proton/container.hpp>
+#include <proton/delivery_mode.hpp>
+#include <proton/sender.hpp>
+#include <proton/sender_options.hpp>
 #include <proton/thread_safe.hpp>
 #include <proton/tracker.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
 
+    //static
+    const char* AmqpSenderBase::s_outcomeNames[OUTCOME_COUNT] = {"accepted", "rejected", "released", "modified"};
+
     AmqpSenderBase::AmqpSenderBase(const std::string& testName,
                                    const std::string& brokerAddr,
                                    const std::string& queueName,
@@ -36,26 +47,239 @@ namespace qpidit
                     AmqpTestBase(testName, brokerAddr, queueName),
                     _totalMsgs(totalMsgs),
                     _msgsSent(0),
-                    _msgsConfirmed(0)
-    {}
+                    _msgsConfirmed(0),
+                    _timestampFlag(false),
+                    _presettledFlag(false),
+                    _numConnections(1),
+                    _numLinks(1),
+                    _connections(),
+                    _senders(),
+                    _linkCounters(),
+                    _sendLock(),
+                    _maxInFlight(0),
+                    _settleStatsFlag(false),
+                    _inFlight(),
+                    _inFlightLock(),
+                    _settleLatency()
+    {
+        for (int i=0; i<OUTCOME_COUNT; ++i) {
+            _outcomeCounts[i] = 0;
+        }
+    }
 
     AmqpSenderBase::~AmqpSenderBase() {}
 
+    void AmqpSenderBase::openLink(proton::connection& c) {
+        openSenders(c, 0, proton::sender_options().handler(*this));
+        _linksOpen += _numLinks;
+    }
+
+    uint32_t AmqpSenderBase::totalMsgs() const {
+        return _totalMsgs;
+    }
+
+    void AmqpSenderBase::printResult(std::ostream& out) {
+        Json::FastWriter fw;
+        if (fanOut()) {
+            Json::Value result(Json::objectValue);
+            Json::Value links(Json::arrayValue);
+            uint32_t totalAccepted = 0;
+            for (std::map<std::string, LinkCounters>::const_iterator i=_linkCounters.begin(); i!=_linkCounters.end(); ++i) {
+                Json::Value link(Json::objectValue);
+                link["name"] = i->first;
+                link["sent"] = i->second.sent;
+                link["accepted"] = i->second.accepted;
+                links.append(link);
+                totalAccepted += i->second.accepted;
+            }
+            result["links"] = links;
+            result["sent"] = _msgsSent;
+            result["accepted"] = totalAccepted;
+            out << fw.write(result);
+        }
+        if (_settleStatsFlag) {
+            Json::Value stats(Json::objectValue);
+            for (int i=0; i<OUTCOME_COUNT; ++i) {
+                stats[s_outcomeNames[i]] = _outcomeCounts[i];
+            }
+            stats["settle_latency"] = _settleLatency.toJson();
+            out << fw.write(stats);
+        }
+    }
+
+    void AmqpSenderBase::setOptions(const ShimArgs& args) {
+        AmqpTestBase::setOptions(args);
+        if (args.hasOption("timestamp")) _timestampFlag = true;
+        if (args.hasOption("presettled")) _presettledFlag = true;
+        _numConnections = args.getUintOption("connections", _numConnections);
+        _numLinks = args.getUintOption("links", _numLinks);
+        _maxInFlight = args.getUintOption("max-in-flight", _maxInFlight);
+        if (args.hasOption("settle-stats")) _settleStatsFlag = true;
+        if (_numConnections == 0 || _numLinks == 0) {
+            throw qpidit::ArgumentError("Options --connections and --links must be at least 1");
+        }
+        if (_presettledFlag && _numThreads > 1) {
+            // Completion stops a multi-threaded container, which would abort pre-settled messages not yet written
+            throw qpidit::ArgumentError("Option --presettled cannot be combined with --threads");
+        }
+    }
+
     void AmqpSenderBase::on_container_start(proton::container &c) {
-        std::ostringstream oss;
-        oss << _brokerAddr << "/" << _queueName;
-        c.open_sender(oss.str());
+        // With --threads, events for the connections may be handled on other threads as soon as they are
+        // opened, so the link counters and containers must not change size after this point
+        if (fanOut()) {
+            for (uint32_t i=0; i<_numConnections; ++i) {
+                for (uint32_t j=0; j<_numLinks; ++j) {
+                    _linkCounters[linkName(i, j)] = LinkCounters();
+                }
+            }
+        }
+        _connections.reserve(_numConnections);
+        _senders.reserve(_numConnections * _numLinks);
+        for (uint32_t i=0; i<_numConnections; ++i) {
+            proton::connection conn = c.connect(_brokerAddr);
+            _connections.push_back(conn);
+            openSenders(conn, i, proton::sender_options());
+        }
     }
 
-    void AmqpSenderBase::on_tracker_accept(proton::tracker &t) {
-        _msgsConfirmed++;
-        if (_msgsConfirmed >= _totalMsgs) {
-            t.connection().close();
+    void AmqpSenderBase::on_sendable(proton::sender &s) {
+        if (_totalMsgs == 0) {
+            sendComplete(s);
+            return;
+        }
+        // Link counters are only touched by events for the link's own connection, which are never concurrent
+        LinkCounters* counters = fanOut() ? &_linkCounters[s.name()] : 0;
+        while (s.credit() > 0) {
+            proton::message msg;
+            proton::message* nextMsg;
+            {
+                // The send cursor is shared by all links, which may be on different threads
+                Mutex::ScopedLock l(_sendLock);
+                if (_msgsSent >= _totalMsgs) break;
+                if (_maxInFlight > 0 && _msgsSent - __atomic_load_n(&_msgsConfirmed, __ATOMIC_SEQ_CST) >= _maxInFlight) {
+                    // Window is full; sending resumes as messages are confirmed
+                    break;
+                }
+                nextMsg = &setNextMessage(msg);
+                _msgsSent++;
+            }
+            if (_timestampFlag) {
+                nextMsg->message_annotations().put(s_sendTimeAnnotation, nowNs());
+            }
+            const int64_t sendTime = _settleStatsFlag ? nowNs() : 0;
+            proton::tracker t = s.send(*nextMsg);
+            if (counters != 0) counters->sent++;
+            if (_presettledFlag) {
+                const uint32_t confirmed = __atomic_add_fetch(&_msgsConfirmed, 1, __ATOMIC_SEQ_CST);
+                reportProgress(confirmed);
+                if (confirmed == _totalMsgs) {
+                    sendComplete(s);
+                    return;
+                }
+            } else if (_settleStatsFlag) {
+                // Only the settlement latency needs each unconfirmed message's send time
+                Mutex::ScopedLock l(_inFlightLock);
+                _inFlight[t] = sendTime;
+            }
         }
     }
 
+    void AmqpSenderBase::on_tracker_accept(proton::tracker &t) {
+        if (fanOut()) _linkCounters[t.sender().name()].accepted++;
+        messageConfirmed(t, OUTCOME_ACCEPTED);
+    }
+
+    void AmqpSenderBase::on_tracker_reject(proton::tracker &t) {
+        messageConfirmed(t, OUTCOME_REJECTED);
+    }
+
+    void AmqpSenderBase::on_tracker_release(proton::tracker &t) {
+        // Proton reports both the released and modified outcomes here
+        messageConfirmed(t, t.state() == proton::transfer::MODIFIED ? OUTCOME_MODIFIED : OUTCOME_RELEASED);
+    }
+
     void AmqpSenderBase::on_transport_close(proton::transport &t) {
-        _msgsSent = _msgsConfirmed;
+        // The send cursor only moves forward, so messages lost with a connection cannot be resent: fail the test
+        if (__atomic_exchange_n(&_complete, true, __ATOMIC_SEQ_CST)) return;
+        std::cerr << _testName << ": Connection closed after " << __atomic_load_n(&_msgsConfirmed, __ATOMIC_SEQ_CST)
+                  << " of " << _totalMsgs << " messages were confirmed" << std::endl;
+        if (_numThreads > 1) {
+            stopContainer(t.connection().container());
+            return;
+        }
+        for (std::vector<proton::connection>::iterator i=_connections.begin(); i!=_connections.end(); ++i) {
+            if (*i != t.connection()) i->close();
+        }
+    }
+
+    // protected
+
+    bool AmqpSenderBase::fanOut() const {
+        return _numConnections > 1 || _numLinks > 1;
+    }
+
+    std::string AmqpSenderBase::linkName(uint32_t connectionIndex, uint32_t linkIndex) const {
+        std::ostringstream oss;
+        oss << _queueName << "-sender-" << connectionIndex << "-" << linkIndex;
+        return oss.str();
+    }
+
+    void AmqpSenderBase::messageConfirmed(proton::tracker& t, outcome_t outcome) {
+        int64_t sendTime = 0;
+        if (_settleStatsFlag) {
+            Mutex::ScopedLock l(_inFlightLock);
+            std::map<proton::tracker, int64_t>::iterator i = _inFlight.find(t);
+            if (i != _inFlight.end()) {
+                sendTime = i->second;
+                _inFlight.erase(i);
+            }
+        }
+        if (sendTime != 0) {
+            const int64_t latencyNs = nowNs() - sendTime;
+            _settleLatency.record(latencyNs > 0 ? latencyNs : 0);
+        }
+        __atomic_add_fetch(&_outcomeCounts[outcome], 1, __ATOMIC_SEQ_CST);
+        proton::sender s = t.sender();
+        const uint32_t confirmed = __atomic_add_fetch(&_msgsConfirmed, 1, __ATOMIC_SEQ_CST);
+        reportProgress(confirmed);
+        if (confirmed == _totalMsgs) {
+            sendComplete(s);
+        } else if (_maxInFlight > 0) {
+            // The window has opened again
+            on_sendable(s);
+        }
+    }
+
+    void AmqpSenderBase::openSenders(proton::connection& c, uint32_t connectionIndex, const proton::sender_options& opts) {
+        for (uint32_t i=0; i<_numLinks; ++i) {
+            proton::sender_options linkOpts(opts);
+            if (_presettledFlag) {
+                linkOpts.delivery_mode(proton::delivery_mode::AT_MOST_ONCE);
+            }
+            if (fanOut()) {
+                linkOpts.name(linkName(connectionIndex, i));
+            }
+            _senders.push_back(c.open_sender(_queueName, linkOpts));
+        }
+    }
+
+    void AmqpSenderBase::sendComplete(proton::sender& s) {
+        if (_numThreads > 1) {
+            // Other connections may only be closed from their own threads, so stop the container instead
+            __atomic_store_n(&_complete, true, __ATOMIC_SEQ_CST);
+            stopContainer(s.connection().container());
+            return;
+        }
+        for (std::vector<proton::sender>::iterator i=_senders.begin(); i!=_senders.end(); ++i) {
+            if (*i != s) i->close();
+        }
+        if (_server == 0) {
+            for (std::vector<proton::connection>::iterator i=_connections.begin(); i!=_connections.end(); ++i) {
+                if (*i != s.connection()) i->close();
+            }
+        }
+        testComplete(s);
     }
 
 } // namespace qpidit
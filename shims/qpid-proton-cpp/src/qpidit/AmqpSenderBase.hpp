@@ -22,19 +22,84 @@
 #ifndef SRC_QPIDIT_AMQPSENDERBASE_HPP_
 #define SRC_QPIDIT_AMQPSENDERBASE_HPP_
 
+#include <map>
 #include <stdint.h>
+#include <proton/connection.hpp>
+#include <proton/message.hpp>
 #include <proton/messaging_handler.hpp>
+#include <proton/sender.hpp>
+#include <proton/tracker.hpp>
 #include <qpidit/AmqpTestBase.hpp>
+#include <qpidit/LatencyHistogram.hpp>
+#include <qpidit/Mutex.hpp>
+#include <vector>
 
 namespace qpidit
 {
 
+    /*
+     * Base class for AMQP senders. The base class owns the send loop: each time the link has credit,
+     * messages are sent until either the credit or the messages run out. The derived class supplies the
+     * messages in order through setNextMessage(), which is called exactly _totalMsgs times and may either fill
+     * in the message passed to it or return a message of its own (eg one built before the test started). With the
+     * --timestamp option, each message is annotated with its send time for receiver latency measurement.
+     * Messages are never resent, so losing a connection before every message is confirmed fails the test.
+     *
+     * For load testing, the --connections=K and --links=L options open L sender links on each of K connections
+     * (only L links on the server connection when run by a shim server). Messages go to whichever link has
+     * credit, so message order is only kept within a link. The number of messages sent and accepted on each
+     * link is printed as a JSON line by printResult().
+     *
+     * With --threads (see AmqpTestBase), the links' events may be handled concurrently: the send cursor is
+     * locked, _msgsConfirmed is updated atomically, and per-link state is only touched by its own connection.
+     *
+     * With --presettled, messages are sent pre-settled (at-most-once). A message then counts as confirmed as soon
+     * as it has been sent, and the test is complete once every message has been sent.
+     *
+     * Otherwise every outcome the receiving peer decides for a message (accepted, rejected, released or modified)
+     * confirms the message and is counted. --max-in-flight=N stops sending while N messages are unconfirmed,
+     * which bounds the peer's unsettled state however much credit is granted. --settle-stats also keeps each
+     * unsettled message in a tracker table with its send time, so that the time from send to outcome is
+     * recorded, and prints the outcome counts and settlement latency as a JSON line from printResult(). The
+     * table and its lock are only used with --settle-stats, so that they cost nothing on the normal send path.
+     */
     class AmqpSenderBase : public AmqpTestBase
     {
     protected:
+        struct LinkCounters
+        {
+            uint32_t sent;
+            uint32_t accepted;
+            LinkCounters() : sent(0), accepted(0) {}
+        };
+
+        enum outcome_t
+        {
+            OUTCOME_ACCEPTED,
+            OUTCOME_REJECTED,
+            OUTCOME_RELEASED,
+            OUTCOME_MODIFIED,
+            OUTCOME_COUNT
+        };
+        static const char* s_outcomeNames[OUTCOME_COUNT];
+
         uint32_t _totalMsgs;
         uint32_t _msgsSent;
         uint32_t _msgsConfirmed;
+        bool _timestampFlag; // Add the send time annotation to each message (--timestamp)
+        bool _presettledFlag; // Send messages pre-settled (--presettled)
+        uint32_t _numConnections; // --connections
+        uint32_t _numLinks; // Links per connection (--links)
+        std::vector<proton::connection> _connections;
+        std::vector<proton::sender> _senders;
+        std::map<std::string, LinkCounters> _linkCounters; // By link name, only when there is more than one link
+        Mutex _sendLock; // Guards _msgsSent and the derived class's send cursor
+        uint32_t _maxInFlight; // Max unconfirmed messages, 0 for no limit (--max-in-flight)
+        bool _settleStatsFlag; // Print outcome counts and settlement latency (--settle-stats)
+        uint32_t _outcomeCounts[OUTCOME_COUNT];
+        std::map<proton::tracker, int64_t> _inFlight; // Send time (ns) of each unconfirmed message, with --settle-stats
+        Mutex _inFlightLock; // Guards _inFlight
+        LatencyHistogram _settleLatency;
 
     public:
         AmqpSenderBase(const std::string& testName,
@@ -43,9 +108,29 @@ namespace qpidit
                        uint32_t totalMsgs);
         virtual ~AmqpSenderBase();
 
+        void openLink(proton::connection& c);
+        void printResult(std::ostream& out);
+        uint32_t totalMsgs() const;
+        void setOptions(const ShimArgs& args);
         void on_container_start(proton::container &c);
+        void on_sendable(proton::sender &s);
         void on_tracker_accept(proton::tracker &t);
+        void on_tracker_reject(proton::tracker &t);
+        void on_tracker_release(proton::tracker &t);
         void on_transport_close(proton::transport &t);
+
+    protected:
+        // Return the next message to be sent, either msg or a message owned by the derived class, and advance
+        // the derived class's send cursor
+        virtual proton::message& setNextMessage(proton::message& msg) = 0;
+
+        bool fanOut() const;
+        std::string linkName(uint32_t connectionIndex, uint32_t linkIndex) const;
+        // Called with the outcome of each unsettled message; completes the test once all are confirmed
+        void messageConfirmed(proton::tracker& t, outcome_t outcome);
+        void openSenders(proton::connection& c, uint32_t connectionIndex, const proton::sender_options& opts);
+        // Close all links (and connections, unless run by a server) once sending is complete on sender s
+        void sendComplete(proton::sender& s);
     };
 
 } // namespace qpidit
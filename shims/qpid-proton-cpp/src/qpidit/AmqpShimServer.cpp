@@ -0,0 +1,253 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/AmqpShimServer.hpp"
+
+#include <iostream>
+#include <json/json.h>
+#include <poll.h>
+#include <unistd.h>
+#include <proton/container.hpp>
+#include <proton/error_condition.hpp>
+#include <proton/transport.hpp>
+#include <qpidit/AmqpTestBase.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
+
+namespace qpidit
+{
+
+    // --- AmqpShimServer::PollTask ---
+
+    AmqpShimServer::PollTask::PollTask(AmqpShimServer& server) : _server(server) {}
+
+    void AmqpShimServer::PollTask::operator()() {
+        _server.poll();
+    }
+
+
+    // --- AmqpShimServer ---
+
+    //static
+    const proton::duration AmqpShimServer::s_pollInterval(10); // ms
+
+    AmqpShimServer::AmqpShimServer(const std::string& testName,
+                                   const ShimArgs& args,
+                                   jobFactory_t jobFactory) :
+                    _testName(testName),
+                    _brokerAddr(args.arg(0)),
+                    _args(args),
+                    _jobFactory(jobFactory),
+                    _pollTask(*this),
+                    _container(0),
+                    _connection(),
+                    _connectionOpen(false),
+                    _transportClosed(false),
+                    _inputBuffer(),
+                    _inputClosed(false),
+                    _pendingJobs(),
+                    _currentJob(0),
+                    _completedJobs(),
+                    _jobOutput(),
+                    _errors()
+    {}
+
+    AmqpShimServer::~AmqpShimServer() {
+        delete _currentJob;
+        deleteCompletedJobs();
+    }
+
+    void AmqpShimServer::run() {
+        // All diagnostics (including those of the test handlers) are returned in the job responses
+        std::streambuf* stderrBuf = std::cerr.rdbuf(_errors.rdbuf());
+        while (!_inputClosed || !_pendingJobs.empty() || _currentJob != 0) {
+            bool jobFailed;
+            try {
+                proton::container(*this).run();
+                jobFailed = failJob(MSG(_testName << ": Connection to " << _brokerAddr << " closed"));
+            } catch (const std::exception& e) {
+                jobFailed = failJob(MSG(_testName << " error: " << e.what()));
+            }
+            // The container is gone, so no handler can reference the old jobs any more
+            deleteCompletedJobs();
+            if (!jobFailed && !_inputClosed) {
+                ::sleep(1); // Lost an idle connection, pause before reconnecting
+            }
+        }
+        std::cerr.rdbuf(stderrBuf);
+    }
+
+    void AmqpShimServer::jobComplete(AmqpTestBase& job) {
+        if (&job != _currentJob) return;
+        _currentJob->printResult(_jobOutput);
+        sendResponse("");
+        retireCurrentJob();
+        startNextJob();
+    }
+
+    std::ostream& AmqpShimServer::jobOutput() {
+        return _jobOutput;
+    }
+
+    void AmqpShimServer::on_container_start(proton::container& c) {
+        _container = &c;
+        _connectionOpen = false;
+        _transportClosed = false;
+        _connection = c.connect(_brokerAddr);
+        c.schedule(s_pollInterval, _pollTask);
+    }
+
+    void AmqpShimServer::on_connection_open(proton::connection&) {
+        _connectionOpen = true;
+        startNextJob();
+    }
+
+    void AmqpShimServer::on_connection_error(proton::connection& c) {
+        std::cerr << _testName << "::on_connection_error: " << c.error() << std::endl;
+    }
+
+    void AmqpShimServer::on_transport_error(proton::transport& t) {
+        std::cerr << _testName << "::on_transport_error: " << t.error() << std::endl;
+    }
+
+    void AmqpShimServer::on_transport_close(proton::transport&) {
+        _connectionOpen = false;
+        _transportClosed = true;
+    }
+
+    void AmqpShimServer::on_error(const proton::error_condition& ec) {
+        std::cerr << _testName << "::on_error(): " << ec << std::endl;
+    }
+
+    // protected
+
+    void AmqpShimServer::poll() {
+        if (_transportClosed) return; // Stop polling so that the container can exit
+        reapCompletedJobs();
+        readInput();
+        startNextJob();
+        if (_currentJob == 0 && _pendingJobs.empty() && _inputClosed) {
+            _connection.close();
+            return;
+        }
+        _container->schedule(s_pollInterval, _pollTask);
+    }
+
+    void AmqpShimServer::readInput() {
+        if (_inputClosed) return;
+        struct pollfd pfd;
+        pfd.fd = STDIN_FILENO;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        while (::poll(&pfd, 1, 0) > 0) {
+            char buf[4096];
+            const ssize_t bytesRead = ::read(STDIN_FILENO, buf, sizeof(buf));
+            if (bytesRead <= 0) {
+                _inputClosed = true;
+                break;
+            }
+            _inputBuffer.append(buf, bytesRead);
+        }
+        std::string::size_type eolPos;
+        while ((eolPos = _inputBuffer.find('\n')) != std::string::npos) {
+            if (eolPos > 0) {
+                _pendingJobs.push_back(_inputBuffer.substr(0, eolPos));
+            }
+            _inputBuffer.erase(0, eolPos + 1);
+        }
+    }
+
+    void AmqpShimServer::startNextJob() {
+        while (_connectionOpen && _currentJob == 0 && !_pendingJobs.empty()) {
+            const std::string jobStr(_pendingJobs.front());
+            _pendingJobs.pop_front();
+            try {
+                Json::Value jobParams;
+                Json::Reader jsonReader;
+                if (not jsonReader.parse(jobStr, jobParams, false)) {
+                    throw qpidit::JsonParserError(jsonReader);
+                }
+                if (!jobParams.isArray() || jobParams.size() != 3) {
+                    throw qpidit::ArgumentError("Invalid job: expected JSON list [queue_name, test_key, test_arg]");
+                }
+                _currentJob = _jobFactory(_brokerAddr, jobParams[0].asString(), jobParams[1].asString(), jobParams[2].asString());
+                _currentJob->setServer(this);
+                _currentJob->setOptions(_args);
+                _currentJob->openLink(_connection);
+            } catch (const std::exception& e) {
+                if (_currentJob != 0) retireCurrentJob();
+                sendResponse(MSG(_testName << " error: " << e.what()));
+            }
+        }
+    }
+
+    bool AmqpShimServer::failJob(const std::string& errorMsg) {
+        if (_currentJob != 0) {
+            retireCurrentJob();
+            sendResponse(errorMsg);
+        } else if (!_pendingJobs.empty()) {
+            // The connection was lost before this job could start, so it is reported as not run rather than failed
+            sendResponse(MSG(errorMsg << ": job not run: " << _pendingJobs.front()));
+            _pendingJobs.pop_front();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void AmqpShimServer::retireCurrentJob() {
+        _completedJobs.push_back(_currentJob);
+        _currentJob = 0;
+    }
+
+    void AmqpShimServer::reapCompletedJobs() {
+        std::vector<AmqpTestBase*>::iterator i = _completedJobs.begin();
+        while (i != _completedJobs.end()) {
+            if ((*i)->linksClosed()) {
+                delete *i;
+                i = _completedJobs.erase(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    void AmqpShimServer::deleteCompletedJobs() {
+        for (std::vector<AmqpTestBase*>::iterator i=_completedJobs.begin(); i!=_completedJobs.end(); ++i) {
+            delete *i;
+        }
+        _completedJobs.clear();
+    }
+
+    void AmqpShimServer::sendResponse(const std::string& errorMsg) {
+        if (!errorMsg.empty()) {
+            _errors << errorMsg << std::endl;
+        }
+        Json::Value response(Json::objectValue);
+        response["stdout"] = _jobOutput.str();
+        response["stderr"] = _errors.str();
+        _jobOutput.str("");
+        _errors.str("");
+        Json::FastWriter fw;
+        std::cout << fw.write(response) << std::flush;
+    }
+
+} /* namespace qpidit */
@@ -0,0 +1,118 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQPSHIMSERVER_HPP_
+#define SRC_QPIDIT_AMQPSHIMSERVER_HPP_
+
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <proton/connection.hpp>
+#include <proton/duration.hpp>
+#include <proton/function.hpp>
+#include <proton/messaging_handler.hpp>
+
+namespace qpidit
+{
+
+    class AmqpTestBase;
+    class ShimArgs;
+
+    /*
+     * Persistent shim server. Rather than running a single test and exiting, the shim keeps one
+     * container and broker connection open and runs successive test jobs read from stdin, one JSON
+     * list per line:
+     *     [queue_name, test_key, test_arg]
+     * which are the same parameters normally passed to the shim as command-line args 2 - 4. Each
+     * job is answered by a single JSON line on stdout:
+     *     {"stdout": <job output>, "stderr": <job errors>}
+     * Shim options given on the server command-line are applied to every job. The server exits once
+     * stdin is closed and the last job is complete.
+     */
+    class AmqpShimServer : public proton::messaging_handler
+    {
+    public:
+        typedef AmqpTestBase* (*jobFactory_t)(const std::string& brokerAddr,
+                                              const std::string& queueName,
+                                              const std::string& testKey,
+                                              const std::string& testArg);
+    protected:
+        class PollTask : public proton::void_function0
+        {
+        protected:
+            AmqpShimServer& _server;
+        public:
+            PollTask(AmqpShimServer& server);
+            void operator()();
+        };
+
+        static const proton::duration s_pollInterval;
+
+        const std::string _testName;
+        const std::string _brokerAddr;
+        const ShimArgs& _args; // Options applied to every job
+        jobFactory_t _jobFactory;
+        PollTask _pollTask;
+        proton::container* _container;
+        proton::connection _connection;
+        bool _connectionOpen;
+        bool _transportClosed;
+        std::string _inputBuffer;
+        bool _inputClosed;
+        std::deque<std::string> _pendingJobs;
+        AmqpTestBase* _currentJob;
+        std::vector<AmqpTestBase*> _completedJobs; // Kept until their links are closed or their connection is gone
+        std::ostringstream _jobOutput;
+        std::ostringstream _errors;
+
+    public:
+        AmqpShimServer(const std::string& testName,
+                       const ShimArgs& args,
+                       jobFactory_t jobFactory);
+        virtual ~AmqpShimServer();
+
+        void run();
+        void jobComplete(AmqpTestBase& job);
+        // Stream collecting the current job's output (its stdout in the normal mode)
+        std::ostream& jobOutput();
+
+        void on_container_start(proton::container& c);
+        void on_connection_open(proton::connection& c);
+        void on_connection_error(proton::connection& c);
+        void on_transport_error(proton::transport& t);
+        void on_transport_close(proton::transport& t);
+        void on_error(const proton::error_condition& ec);
+
+    protected:
+        void poll();
+        void readInput();
+        void startNextJob();
+        bool failJob(const std::string& errorMsg);
+        void retireCurrentJob();
+        void reapCompletedJobs();
+        void deleteCompletedJobs();
+        void sendResponse(const std::string& errorMsg);
+    };
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQPSHIMSERVER_HPP_ */
@@ -21,26 +21,82 @@
 
 #include "qpidit/AmqpTestBase.hpp"
 
+#include <cstdio>
 #include <iostream>
+#include <time.h>
+#include <unistd.h>
 #include <proton/connection.hpp>
+#include <proton/container.hpp>
 #include <proton/error_condition.hpp>
+#include <proton/receiver.hpp>
 #include <proton/sender.hpp>
 #include <proton/session.hpp>
 #include <proton/transport.hpp>
+#include <qpidit/AmqpShimServer.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
 
+    //static
+    const proton::symbol AmqpTestBase::s_sendTimeAnnotation("x-opt-qpidit-send-time");
+    const int64_t AmqpTestBase::s_progressIntervalNs = 100000000LL; // 100ms
+
     AmqpTestBase::AmqpTestBase(const std::string& testName,
                                const std::string& brokerAddr,
                                const std::string& queueName):
                     _testName(testName),
                     _brokerAddr(brokerAddr),
-                    _queueName(queueName)
+                    _queueName(queueName),
+                    _server(0),
+                    _complete(false),
+                    _numThreads(1),
+                    _progressFd(-1),
+                    _lastProgressNs(0),
+                    _linksOpen(0)
     {}
 
     AmqpTestBase::~AmqpTestBase() {}
 
+    void AmqpTestBase::printResult(std::ostream&) {}
+
+    void AmqpTestBase::setOptions(const ShimArgs& args) {
+        _numThreads = args.getUintOption("threads", _numThreads);
+        if (_numThreads == 0) {
+            throw qpidit::ArgumentError("Option --threads must be at least 1");
+        }
+        if (_numThreads > 1 && args.hasOption("server")) {
+            // Completion would stop the server's shared container rather than just finish the job
+            throw qpidit::ArgumentError("Option --threads cannot be combined with --server");
+        }
+#ifndef QPIDIT_CONTAINER_THREADS
+        if (_numThreads > 1) {
+            throw qpidit::ArgumentError("Option --threads requires Qpid Proton C++ 0.18 or later");
+        }
+#endif
+        if (args.hasOption("progress-fd")) {
+            _progressFd = args.getUintOption("progress-fd", 0);
+        }
+    }
+
+    void AmqpTestBase::setServer(AmqpShimServer* server) {
+        _server = server;
+    }
+
+    bool AmqpTestBase::linksClosed() const {
+        return _linksOpen == 0;
+    }
+
+    void AmqpTestBase::run() {
+        proton::container c(*this);
+#ifdef QPIDIT_CONTAINER_THREADS
+        c.run(_numThreads);
+#else
+        c.run();
+#endif
+    }
+
     void AmqpTestBase::on_connection_error(proton::connection& c) {
         std::cerr << _testName << "::on_connection_error: " << c.error() << std::endl;
     }
@@ -53,6 +109,18 @@ namespace qpidit
         std::cerr << _testName << "::on_sender_error: " << s.error() << std::endl;
     }
 
+    void AmqpTestBase::on_receiver_error(proton::receiver& r) {
+        std::cerr << _testName << "::on_receiver_error: " << r.error() << std::endl;
+    }
+
+    void AmqpTestBase::on_sender_close(proton::sender&) {
+        if (_linksOpen > 0) --_linksOpen;
+    }
+
+    void AmqpTestBase::on_receiver_close(proton::receiver&) {
+        if (_linksOpen > 0) --_linksOpen;
+    }
+
     void AmqpTestBase::on_transport_error(proton::transport& t) {
         std::cerr << _testName << "::on_transport_error: " << t.error() << std::endl;
     }
@@ -61,4 +129,54 @@ namespace qpidit
         std::cerr << _testName << "::on_error(): " << ec << std::endl;
     }
 
+    // protected
+
+    void AmqpTestBase::testComplete(proton::link l) {
+        if (_complete) return;
+        _complete = true;
+        flushLink(l);
+        l.close();
+        if (_server == 0) {
+            l.connection().close();
+        } else {
+            // Leave the connection open for the next job
+            _server->jobComplete(*this);
+        }
+    }
+
+    void AmqpTestBase::flushLink(proton::link&) {}
+
+    void AmqpTestBase::stopContainer(proton::container& c) {
+#ifdef QPIDIT_CONTAINER_THREADS
+        c.stop();
+#else
+        (void)c; // Only a multi-threaded container is stopped
+#endif
+    }
+
+    std::ostream& AmqpTestBase::resultStream() {
+        return _server == 0 ? std::cout : _server->jobOutput();
+    }
+
+    void AmqpTestBase::reportProgress(uint32_t count) {
+        if (_progressFd < 0) return;
+        const int64_t now = nowNs();
+        // May be called from more than one thread with --threads; a lost update only costs an extra report
+        if (now - __atomic_load_n(&_lastProgressNs, __ATOMIC_RELAXED) < s_progressIntervalNs) return;
+        __atomic_store_n(&_lastProgressNs, now, __ATOMIC_RELAXED);
+        char buf[16];
+        const int len = std::snprintf(buf, sizeof(buf), "%u\n", count);
+        // Progress is only advisory, so a failed write is not a test error
+        if (::write(_progressFd, buf, len) != len) {
+            _progressFd = -1;
+        }
+    }
+
+    //static
+    int64_t AmqpTestBase::nowNs() {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+        return int64_t(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
 } // namespace qpidit
@@ -22,18 +22,43 @@
 #ifndef SRC_QPIDIT_AMQPTESTBASE_HPP_
 #define SRC_QPIDIT_AMQPTESTBASE_HPP_
 
+#include <ostream>
+#include <stdint.h>
 #include <string>
+#include <proton/link.hpp>
 #include <proton/messaging_handler.hpp>
+#include <proton/symbol.hpp>
 
 namespace qpidit
 {
 
+    class AmqpShimServer;
+    class ShimArgs;
+
+    /*
+     * Base class for AMQP tests. Tests run from a shim main() are started by run(), which with the --threads=N
+     * option runs the container on N worker threads (requires Qpid Proton C++ 0.18 or later, which defines
+     * QPIDIT_CONTAINER_THREADS in the build). Events for one connection are never handled concurrently, but
+     * events for different connections may be, so state shared between connections must be made safe.
+     * Jobs of a persistent shim server (--server) share the server's single-threaded container, so --threads
+     * cannot be combined with --server.
+     *
+     * With --progress-fd=N, derived classes report the number of messages handled so far as a decimal line
+     * written to file descriptor N (at most every s_progressIntervalNs), so that the test program can tell a
+     * slow test from a hung one.
+     */
     class AmqpTestBase : public proton::messaging_handler
     {
     protected:
         const std::string _testName;
         const std::string _brokerAddr;
         const std::string _queueName;
+        AmqpShimServer* _server; // Set only when running as a job of a persistent shim server
+        bool _complete;
+        uint32_t _numThreads; // Container worker threads (--threads)
+        int _progressFd; // Where progress is reported, -1 for none (--progress-fd)
+        int64_t _lastProgressNs;
+        uint32_t _linksOpen; // Links opened by openLink() and not yet closed by the peer
 
     public:
         AmqpTestBase(const std::string& testName,
@@ -41,11 +66,43 @@ namespace qpidit
                      const std::string& queueName);
         virtual ~AmqpTestBase();
 
+        // Open this test's link on an existing connection (used by AmqpShimServer)
+        virtual void openLink(proton::connection& c) = 0;
+        // Print the test result in the format expected by the test program
+        virtual void printResult(std::ostream& out);
+        // Apply shim options (--name[=value] command-line args)
+        virtual void setOptions(const ShimArgs& args);
+        void setServer(AmqpShimServer* server);
+        // True once every link opened by openLink() has been closed by the peer, so no more events can arrive
+        bool linksClosed() const;
+        // Run this test in its own container, on _numThreads threads
+        void run();
+
         void on_connection_error(proton::connection& c);
         void on_session_error(proton::session& s);
         void on_sender_error(proton::sender& s);
+        void on_receiver_error(proton::receiver& r);
+        void on_sender_close(proton::sender& s);
+        void on_receiver_close(proton::receiver& r);
         void on_transport_error(proton::transport& t);
         void on_error(const proton::error_condition& c);
+
+    protected:
+        // Message annotation carrying the send time (see nowNs()) of a message
+        static const proton::symbol s_sendTimeAnnotation;
+        static const int64_t s_progressIntervalNs;
+
+        void testComplete(proton::link l);
+        // Called by testComplete() before the link is closed, for derived classes holding back work on it
+        virtual void flushLink(proton::link& l);
+        void stopContainer(proton::container& c);
+        // Where results are printed while the test runs: stdout, or the job output when run by a server
+        std::ostream& resultStream();
+        // Report that count messages have been handled, if --progress-fd is set
+        void reportProgress(uint32_t count);
+
+        // Wall clock time in ns since the epoch, so that times taken by a sender and receiver on the same host compare
+        static int64_t nowNs();
     };
 
 } // namespace qpidit
@@ -0,0 +1,66 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/BenchBase.hpp"
+
+#include <json/json.h>
+#include <time.h>
+#include <vector>
+
+namespace qpidit
+{
+
+    BenchBase::BenchBase(const ShimArgs& args, uint32_t defaultRepeat) :
+                    _repeat(args.getUintOption("repeat", defaultRepeat))
+    {
+        if (_repeat == 0) {
+            throw ArgumentError("Option --repeat must be at least 1");
+        }
+    }
+
+    BenchBase::~BenchBase() {}
+
+    void BenchBase::run(const Json::Value& testValueMap, std::ostream& out) {
+        if (!testValueMap.isObject()) {
+            throw InvalidJsonRootNodeError(Json::objectValue, testValueMap.type());
+        }
+        Json::FastWriter fw;
+        const std::vector<std::string> amqpTypes = testValueMap.getMemberNames();
+        for (std::vector<std::string>::const_iterator i = amqpTypes.begin(); i != amqpTypes.end(); ++i) {
+            const Json::Value& testValues = testValueMap[*i];
+            if (!testValues.isArray()) {
+                throw InvalidJsonRootNodeError(Json::arrayValue, testValues.type());
+            }
+            out << fw.write(runType(*i, testValues));
+            out.flush();
+        }
+    }
+
+    // protected
+
+    //static
+    int64_t BenchBase::nowNs() {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return int64_t(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+} /* namespace qpidit */
@@ -0,0 +1,79 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_BENCHBASE_HPP_
+#define SRC_QPIDIT_BENCHBASE_HPP_
+
+#include <iostream>
+#include <json/value.h>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
+#include <stdint.h>
+#include <string>
+
+namespace qpidit
+{
+
+    /*
+     * Base for the shim benchmark programs, which take a JSON map of AMQP type to a list of test values and
+     * print one JSON result line per type. Derived classes time a single type in runType().
+     */
+    class BenchBase
+    {
+    protected:
+        const uint32_t _repeat; // Number of times each list of test values is run (--repeat)
+    public:
+        BenchBase(const ShimArgs& args, uint32_t defaultRepeat);
+        virtual ~BenchBase();
+
+        // Prints one JSON result line per AMQP type in testValueMap
+        void run(const Json::Value& testValueMap, std::ostream& out);
+
+        // Shared main(): runs a B constructed from the command line on its single test value map argument
+        template<class B> static int main(int argc, char** argv, const std::string& benchName);
+    protected:
+        virtual Json::Value runType(const std::string& amqpType, const Json::Value& testValues) = 0;
+
+        // Monotonic time in ns, for timing intervals within this process
+        static int64_t nowNs();
+    };
+
+    template<class B> int BenchBase::main(int argc, char** argv, const std::string& benchName) {
+        try {
+            ShimArgs args(argc, argv);
+            if (args.numArgs() != 1) {
+                throw ArgumentError("Incorrect number of arguments");
+            }
+            Json::Value testValueMap;
+            args.jsonArg(0, testValueMap);
+
+            B bench(args);
+            bench.run(testValueMap, std::cout);
+        } catch (const std::exception& e) {
+            std::cerr << benchName << " error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_BENCHBASE_HPP_ */
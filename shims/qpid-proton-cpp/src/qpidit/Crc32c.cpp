@@ -0,0 +1,101 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/Crc32c.hpp"
+
+#include <cstring>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+namespace
+{
+    // Slicing-by-8 tables for the reflected CRC32C polynomial
+    struct Crc32cTable
+    {
+        uint32_t t[8][256];
+        Crc32cTable() {
+            for (uint32_t i=0; i<256; ++i) {
+                uint32_t crc = i;
+                for (int j=0; j<8; ++j) {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+                }
+                t[0][i] = crc;
+            }
+            for (uint32_t i=0; i<256; ++i) {
+                for (int k=1; k<8; ++k) {
+                    t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xff];
+                }
+            }
+        }
+    };
+}
+
+namespace qpidit
+{
+
+    Crc32c::Crc32c() : _crc(0) {}
+
+    Crc32c::~Crc32c() {}
+
+    void Crc32c::reset() {
+        _crc = 0;
+    }
+
+    void Crc32c::update(const char* data, std::size_t size) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        uint32_t crc = ~_crc;
+#ifdef __SSE4_2__
+        for (; size >= 8; p += 8, size -= 8) {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            crc = uint32_t(_mm_crc32_u64(crc, v));
+        }
+        for (; size > 0; ++p, --size) {
+            crc = _mm_crc32_u8(crc, *p);
+        }
+#else
+        static const Crc32cTable table;
+        const uint32_t (&t)[8][256] = table.t;
+        for (; size >= 8; p += 8, size -= 8) {
+            const uint32_t lo = crc ^ (uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+            crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+                  t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+        }
+        for (; size > 0; ++p, --size) {
+            crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+        }
+#endif
+        _crc = ~crc;
+    }
+
+    uint32_t Crc32c::value() const {
+        return _crc;
+    }
+
+    //static
+    uint32_t Crc32c::compute(const char* data, std::size_t size) {
+        Crc32c crc;
+        crc.update(data, size);
+        return crc.value();
+    }
+
+} /* namespace qpidit */
@@ -0,0 +1,52 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_CRC32C_HPP_
+#define SRC_QPIDIT_CRC32C_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace qpidit
+{
+
+    /*
+     * CRC32C (Castagnoli) checksum, used to check the integrity of large message content end to end.
+     * Uses the SSE4.2 crc32 instruction when compiled for it, otherwise a slicing-by-8 lookup table.
+     */
+    class Crc32c
+    {
+    protected:
+        uint32_t _crc;
+    public:
+        Crc32c();
+        virtual ~Crc32c();
+
+        void reset();
+        void update(const char* data, std::size_t size);
+        uint32_t value() const;
+
+        static uint32_t compute(const char* data, std::size_t size);
+    };
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_CRC32C_HPP_ */
@@ -0,0 +1,455 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/JavaObjectSerializer.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <qpidit/QpidItErrors.hpp>
+#include <strings.h>
+
+namespace
+{
+    // Stream protocol constants, see java.io.ObjectStreamConstants
+    const uint16_t STREAM_MAGIC = 0xaced;
+    const uint16_t STREAM_VERSION = 5;
+    const uint8_t TC_NULL = 0x70;
+    const uint8_t TC_CLASSDESC = 0x72;
+    const uint8_t TC_OBJECT = 0x73;
+    const uint8_t TC_STRING = 0x74;
+    const uint8_t TC_ENDBLOCKDATA = 0x78;
+    const uint8_t TC_LONGSTRING = 0x7c;
+    const uint8_t SC_SERIALIZABLE = 0x02;
+
+    const char* NUMBER_CLASS_NAME = "java.lang.Number";
+    const uint64_t NUMBER_SERIAL_VERSION_UID = 0x86ac951d0b94e08bULL;
+
+    void putBytes(proton::binary& out, uint64_t val, std::size_t numBytes) {
+        for (std::size_t i=numBytes; i>0; --i) {
+            out.push_back(uint8_t(val >> ((i - 1) * 8)));
+        }
+    }
+
+    void putUtf(proton::binary& out, const std::string& str) {
+        putBytes(out, str.size(), 2);
+        out.insert(out.end(), str.begin(), str.end());
+    }
+
+    uint64_t getBytes(const proton::binary& in, std::size_t& pos, std::size_t numBytes) {
+        if (in.size() - pos < numBytes) {
+            throw qpidit::JavaObjectSerializationError("", "Truncated serialized object");
+        }
+        uint64_t val = 0;
+        for (std::size_t i=0; i<numBytes; ++i) {
+            val = (val << 8) | uint8_t(in[pos++]);
+        }
+        return val;
+    }
+
+    std::string getUtf(const proton::binary& in, std::size_t& pos, std::size_t len) {
+        if (in.size() - pos < len) {
+            throw qpidit::JavaObjectSerializationError("", "Truncated serialized object");
+        }
+        std::string str(in.begin() + pos, in.begin() + pos + len);
+        pos += len;
+        return str;
+    }
+
+    // Return the code point at pos in UTF-8 string str and advance pos, or -1 if the encoding is invalid
+    int32_t getUtf8CodePoint(const std::string& str, std::size_t& pos) {
+        const uint8_t b0 = str[pos];
+        std::size_t len;
+        int32_t cp;
+        if (b0 < 0x80) { len = 1; cp = b0; }
+        else if ((b0 & 0xe0) == 0xc0) { len = 2; cp = b0 & 0x1f; }
+        else if ((b0 & 0xf0) == 0xe0) { len = 3; cp = b0 & 0x0f; }
+        else if ((b0 & 0xf8) == 0xf0) { len = 4; cp = b0 & 0x07; }
+        else return -1;
+        if (str.size() - pos < len) return -1;
+        for (std::size_t i=1; i<len; ++i) {
+            const uint8_t b = str[pos + i];
+            if ((b & 0xc0) != 0x80) return -1;
+            cp = (cp << 6) | (b & 0x3f);
+        }
+        pos += len;
+        return cp;
+    }
+
+    void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out.push_back(char(cp));
+        } else if (cp < 0x800) {
+            out.push_back(char(0xc0 | (cp >> 6)));
+            out.push_back(char(0x80 | (cp & 0x3f)));
+        } else if (cp < 0x10000) {
+            out.push_back(char(0xe0 | (cp >> 12)));
+            out.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+            out.push_back(char(0x80 | (cp & 0x3f)));
+        } else {
+            out.push_back(char(0xf0 | (cp >> 18)));
+            out.push_back(char(0x80 | ((cp >> 12) & 0x3f)));
+            out.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+            out.push_back(char(0x80 | (cp & 0x3f)));
+        }
+    }
+
+    // Modified UTF-8 encodes each UTF-16 code unit separately, and NUL as two bytes
+    void appendModifiedUtf8(std::string& out, uint16_t unit) {
+        if (unit == 0) {
+            out.push_back(char(0xc0));
+            out.push_back(char(0x80));
+        } else {
+            appendUtf8(out, unit);
+        }
+    }
+
+    bool isJavaIntegral(const std::string& str) {
+        std::size_t start = (!str.empty() && (str[0] == '-' || str[0] == '+')) ? 1 : 0;
+        return str.size() > start && str.find_first_not_of("0123456789", start) == std::string::npos;
+    }
+}
+
+namespace qpidit
+{
+
+    //static
+    const JavaObjectSerializer::BoxedType JavaObjectSerializer::s_boxedTypes[] = {
+        {"java.lang.Boolean",   0xcd207280d59cfaeeULL, 'Z', false},
+        {"java.lang.Byte",      0x9c4e6084ee50f51cULL, 'B', true},
+        {"java.lang.Character", 0x348b47d96b1a2678ULL, 'C', false},
+        {"java.lang.Double",    0x80b3c24a296bfb04ULL, 'D', true},
+        {"java.lang.Float",     0xdaedc9a2db3cf0ecULL, 'F', true},
+        {"java.lang.Integer",   0x12e2a0a4f7818738ULL, 'I', true},
+        {"java.lang.Long",      0x3b8be490cc8f23dfULL, 'J', true},
+        {"java.lang.Short",     0x684d37133460da52ULL, 'S', true},
+        {0, 0, 0, false}
+    };
+    const char* JavaObjectSerializer::s_stringClassName = "java.lang.String";
+
+    //static
+    bool JavaObjectSerializer::isSupported(const std::string& javaClassName) {
+        return javaClassName.compare(s_stringClassName) == 0 || findBoxedType(javaClassName) != 0;
+    }
+
+    //static
+    proton::binary JavaObjectSerializer::serialize(const std::string& javaClassName, const std::string& valAsString) {
+        const std::string javaClassStr = javaClassName + ":" + valAsString;
+        proton::binary out;
+        putBytes(out, STREAM_MAGIC, 2);
+        putBytes(out, STREAM_VERSION, 2);
+        if (javaClassName.compare(s_stringClassName) == 0) {
+            const std::string mUtf8 = utf8ToModifiedUtf8(valAsString);
+            if (mUtf8.size() > 0xffff) {
+                out.push_back(TC_LONGSTRING);
+                putBytes(out, mUtf8.size(), 8);
+            } else {
+                out.push_back(TC_STRING);
+                putBytes(out, mUtf8.size(), 2);
+            }
+            out.insert(out.end(), mUtf8.begin(), mUtf8.end());
+            return out;
+        }
+        const BoxedType* type = findBoxedType(javaClassName);
+        if (type == 0) {
+            throw qpidit::JavaObjectSerializationError(javaClassStr, "Unsupported class");
+        }
+        out.push_back(TC_OBJECT);
+        out.push_back(TC_CLASSDESC);
+        putUtf(out, type->className);
+        putBytes(out, type->serialVersionUid, 8);
+        out.push_back(SC_SERIALIZABLE);
+        putBytes(out, 1, 2); // Field count
+        out.push_back(uint8_t(type->typeCode));
+        putUtf(out, "value");
+        out.push_back(TC_ENDBLOCKDATA); // No class annotations
+        if (type->isNumber) {
+            out.push_back(TC_CLASSDESC);
+            putUtf(out, NUMBER_CLASS_NAME);
+            putBytes(out, NUMBER_SERIAL_VERSION_UID, 8);
+            out.push_back(SC_SERIALIZABLE);
+            putBytes(out, 0, 2);
+            out.push_back(TC_ENDBLOCKDATA);
+        }
+        out.push_back(TC_NULL); // java.lang.Object is not serializable
+        writeValue(out, *type, valAsString);
+        return out;
+    }
+
+    //static
+    std::string JavaObjectSerializer::deserialize(const proton::binary& bytes, std::string& valAsString) {
+        std::size_t pos = 0;
+        if (getBytes(bytes, pos, 2) != STREAM_MAGIC || getBytes(bytes, pos, 2) != STREAM_VERSION) {
+            throw qpidit::JavaObjectSerializationError("", "Not a Java serialization stream");
+        }
+        const uint8_t tc = getBytes(bytes, pos, 1);
+        if (tc == TC_STRING || tc == TC_LONGSTRING) {
+            const std::size_t len = getBytes(bytes, pos, tc == TC_STRING ? 2 : 8);
+            valAsString = modifiedUtf8ToUtf8(getUtf(bytes, pos, len));
+            return s_stringClassName;
+        }
+        if (tc != TC_OBJECT || getBytes(bytes, pos, 1) != TC_CLASSDESC) {
+            throw qpidit::JavaObjectSerializationError("", "Unsupported serialized object");
+        }
+        const std::string className = getUtf(bytes, pos, getBytes(bytes, pos, 2));
+        const BoxedType* type = findBoxedType(className);
+        if (type == 0) {
+            throw qpidit::JavaObjectSerializationError(className, "Unsupported class");
+        }
+        getBytes(bytes, pos, 8); // serialVersionUID
+        getBytes(bytes, pos, 1); // Flags
+        if (getBytes(bytes, pos, 2) != 1 || getBytes(bytes, pos, 1) != uint8_t(type->typeCode) ||
+                getUtf(bytes, pos, getBytes(bytes, pos, 2)).compare("value") != 0 ||
+                getBytes(bytes, pos, 1) != TC_ENDBLOCKDATA) {
+            throw qpidit::JavaObjectSerializationError(className, "Unexpected class description");
+        }
+        // Superclasses (java.lang.Number) have no fields
+        uint8_t superTc;
+        while ((superTc = getBytes(bytes, pos, 1)) == TC_CLASSDESC) {
+            getUtf(bytes, pos, getBytes(bytes, pos, 2));
+            getBytes(bytes, pos, 8); // serialVersionUID
+            getBytes(bytes, pos, 1); // Flags
+            if (getBytes(bytes, pos, 2) != 0 || getBytes(bytes, pos, 1) != TC_ENDBLOCKDATA) {
+                throw qpidit::JavaObjectSerializationError(className, "Unexpected superclass description");
+            }
+        }
+        if (superTc != TC_NULL) {
+            throw qpidit::JavaObjectSerializationError(className, "Unexpected superclass description");
+        }
+        valAsString = readValue(bytes, pos, *type);
+        return className;
+    }
+
+    // protected
+
+    //static
+    const JavaObjectSerializer::BoxedType* JavaObjectSerializer::findBoxedType(const std::string& javaClassName) {
+        for (const BoxedType* t=s_boxedTypes; t->className!=0; ++t) {
+            if (javaClassName.compare(t->className) == 0) return t;
+        }
+        return 0;
+    }
+
+    //static
+    void JavaObjectSerializer::writeValue(proton::binary& out, const BoxedType& type, const std::string& valAsString) {
+        switch (type.typeCode) {
+        case 'Z': {
+            // new Boolean(String) is true only for "true", ignoring case
+            bool val = valAsString.size() == 4 && ::strncasecmp(valAsString.c_str(), "true", 4) == 0;
+            out.push_back(val ? 1 : 0);
+            return;
+        }
+        case 'C': {
+            uint32_t val;
+            if (valAsString.size() >= 4 && valAsString[0] == '\\' && valAsString[1] == 'x') { // Format: '\xNN' or '\xNNNN'
+                char* end;
+                val = std::strtoul(valAsString.c_str() + 2, &end, 16);
+                if (*end != '\0' || val > 0xffff) throw qpidit::InvalidTestValueError(type.className, valAsString);
+            } else { // Format: 'c'
+                std::size_t pos = 0;
+                const int32_t cp = valAsString.empty() ? -1 : getUtf8CodePoint(valAsString, pos);
+                if (cp < 0 || cp > 0xffff || pos != valAsString.size()) {
+                    throw qpidit::InvalidTestValueError(type.className, valAsString);
+                }
+                val = cp;
+            }
+            putBytes(out, val, 2);
+            return;
+        }
+        case 'D':
+        case 'F': {
+            // Parse floats directly rather than rounding twice through a double
+            char* end;
+            float f = 0;
+            double val = 0;
+            if (type.typeCode == 'F') f = std::strtof(valAsString.c_str(), &end);
+            else val = std::strtod(valAsString.c_str(), &end);
+            // A trailing type suffix (eg "1.5f") is allowed, as in Java
+            if (end == valAsString.c_str() || (*end != '\0' && (std::strchr("fFdD", *end) == 0 || *(end + 1) != '\0'))) {
+                throw qpidit::InvalidTestValueError(type.className, valAsString);
+            }
+            if (type.typeCode == 'F') {
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                putBytes(out, std::isnan(f) ? 0x7fc00000 : bits, 4); // Canonical NaN, as floatToIntBits()
+            } else {
+                uint64_t bits;
+                std::memcpy(&bits, &val, sizeof(bits));
+                putBytes(out, std::isnan(val) ? 0x7ff8000000000000ULL : bits, 8); // As doubleToLongBits()
+            }
+            return;
+        }
+        default: {
+            // new Byte/Short/Integer/Long(String): optionally signed decimal
+            const std::size_t numBytes = type.typeCode == 'B' ? 1 : type.typeCode == 'S' ? 2 : type.typeCode == 'I' ? 4 : 8;
+            const int64_t maxVal = numBytes == 8 ? std::numeric_limits<int64_t>::max() : (int64_t(1) << (numBytes * 8 - 1)) - 1;
+            errno = 0;
+            const int64_t val = std::strtoll(valAsString.c_str(), 0, 10);
+            if (!isJavaIntegral(valAsString) || errno == ERANGE || val > maxVal || val < -maxVal - 1) {
+                throw qpidit::InvalidTestValueError(type.className, valAsString);
+            }
+            putBytes(out, uint64_t(val), numBytes);
+        }
+        }
+    }
+
+    //static
+    std::string JavaObjectSerializer::readValue(const proton::binary& bytes, std::size_t& pos, const BoxedType& type) {
+        char buf[32];
+        switch (type.typeCode) {
+        case 'Z':
+            return getBytes(bytes, pos, 1) ? "true" : "false";
+        case 'C': {
+            std::string str;
+            appendUtf8(str, getBytes(bytes, pos, 2));
+            return str;
+        }
+        case 'D': {
+            const uint64_t bits = getBytes(bytes, pos, 8);
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            return toJavaString(d, false);
+        }
+        case 'F': {
+            const uint32_t bits = getBytes(bytes, pos, 4);
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return toJavaString(f, true);
+        }
+        case 'B':
+            std::snprintf(buf, sizeof(buf), "%d", int(int8_t(getBytes(bytes, pos, 1))));
+            return buf;
+        case 'S':
+            std::snprintf(buf, sizeof(buf), "%d", int(int16_t(getBytes(bytes, pos, 2))));
+            return buf;
+        case 'I':
+            std::snprintf(buf, sizeof(buf), "%d", int(int32_t(getBytes(bytes, pos, 4))));
+            return buf;
+        default:
+            std::snprintf(buf, sizeof(buf), "%lld", (long long)int64_t(getBytes(bytes, pos, 8)));
+            return buf;
+        }
+    }
+
+    //static
+    std::string JavaObjectSerializer::toJavaString(double d, bool isFloat) {
+        if (std::isnan(d)) return "NaN";
+        if (std::isinf(d)) return d < 0 ? "-Infinity" : "Infinity";
+        if (d == 0.0) return std::signbit(d) ? "-0.0" : "0.0";
+
+        // Find the fewest significant digits that still identify the value uniquely, as Java does
+        char buf[32];
+        const int maxDigits = isFloat ? 9 : 17;
+        for (int digits=1; digits<=maxDigits; ++digits) {
+            std::snprintf(buf, sizeof(buf), "%.*e", digits - 1, d);
+            if (isFloat ? std::strtof(buf, 0) == float(d) : std::strtod(buf, 0) == d) break;
+        }
+
+        // buf is [-]d[.ddd]e[+-]xx: split into sign, digit string and decimal exponent
+        std::string mantissa(buf, std::strchr(buf, 'e'));
+        const int exponent = std::atoi(std::strchr(buf, 'e') + 1);
+        std::string sign;
+        if (mantissa[0] == '-') {
+            sign = "-";
+            mantissa.erase(0, 1);
+        }
+        std::string digitStr;
+        for (std::string::const_iterator i=mantissa.begin(); i!=mantissa.end(); ++i) {
+            if (*i != '.') digitStr.push_back(*i);
+        }
+        while (digitStr.size() > 1 && digitStr[digitStr.size()-1] == '0') {
+            digitStr.erase(digitStr.size()-1);
+        }
+
+        std::string result(sign);
+        if (exponent >= -3 && exponent < 7) {
+            // Plain notation with at least one digit after the point, eg "0.001", "1234567.0"
+            if (exponent < 0) {
+                result.append("0.").append(-exponent - 1, '0').append(digitStr);
+            } else {
+                if (digitStr.size() <= std::size_t(exponent) + 1) {
+                    digitStr.append(exponent + 2 - digitStr.size(), '0');
+                }
+                result.append(digitStr, 0, exponent + 1).append(".").append(digitStr, exponent + 1, std::string::npos);
+            }
+        } else {
+            // Computerized scientific notation, eg "1.0E7", "-2.5E-4"
+            result.push_back(digitStr[0]);
+            result.append(".").append(digitStr.size() > 1 ? digitStr.substr(1) : "0");
+            std::snprintf(buf, sizeof(buf), "E%d", exponent);
+            result.append(buf);
+        }
+        return result;
+    }
+
+    //static
+    std::string JavaObjectSerializer::utf8ToModifiedUtf8(const std::string& str) {
+        std::string out;
+        out.reserve(str.size());
+        std::size_t pos = 0;
+        while (pos < str.size()) {
+            const int32_t cp = getUtf8CodePoint(str, pos);
+            if (cp < 0) {
+                throw qpidit::JavaObjectSerializationError(std::string(s_stringClassName) + ":" + str, "Invalid UTF-8");
+            }
+            if (cp > 0xffff) {
+                // Supplementary characters are written as a surrogate pair
+                appendModifiedUtf8(out, uint16_t(0xd800 + ((cp - 0x10000) >> 10)));
+                appendModifiedUtf8(out, uint16_t(0xdc00 + ((cp - 0x10000) & 0x3ff)));
+            } else {
+                appendModifiedUtf8(out, uint16_t(cp));
+            }
+        }
+        return out;
+    }
+
+    //static
+    std::string JavaObjectSerializer::modifiedUtf8ToUtf8(const std::string& str) {
+        std::string out;
+        out.reserve(str.size());
+        std::size_t pos = 0;
+        uint32_t highSurrogate = 0;
+        while (pos < str.size()) {
+            const int32_t unit = getUtf8CodePoint(str, pos);
+            if (unit < 0 || unit > 0xffff) {
+                throw qpidit::JavaObjectSerializationError(s_stringClassName, "Invalid modified UTF-8");
+            }
+            if (unit >= 0xd800 && unit < 0xdc00) {
+                if (highSurrogate != 0) appendUtf8(out, highSurrogate);
+                highSurrogate = unit;
+                continue;
+            }
+            if (unit >= 0xdc00 && unit < 0xe000 && highSurrogate != 0) {
+                appendUtf8(out, 0x10000 + ((highSurrogate - 0xd800) << 10) + (unit - 0xdc00));
+            } else {
+                if (highSurrogate != 0) appendUtf8(out, highSurrogate);
+                appendUtf8(out, unit);
+            }
+            highSurrogate = 0;
+        }
+        if (highSurrogate != 0) appendUtf8(out, highSurrogate);
+        return out;
+    }
+
+} /* namespace qpidit */
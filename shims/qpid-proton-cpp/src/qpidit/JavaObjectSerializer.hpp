@@ -0,0 +1,72 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_JAVAOBJECTSERIALIZER_HPP_
+#define SRC_QPIDIT_JAVAOBJECTSERIALIZER_HPP_
+
+#include <proton/binary.hpp>
+#include <stdint.h>
+#include <string>
+
+namespace qpidit
+{
+
+    /*
+     * Encoder and decoder for the Java Object Serialization Stream Protocol, limited to the java.lang boxed types
+     * (Boolean, Byte, Short, Integer, Long, Float, Double, Character) and String. The bytes produced are those of
+     * ObjectOutputStream.writeObject() on a new stream, so JMS ObjectMessage bodies for these types need no JVM.
+     *
+     * Values are given and returned as strings: serialize() parses them as the class's String constructor would
+     * (Character takes a single character or '\xNN'/'\xNNNN', as JavaObjToBytes does), and deserialize() returns
+     * the object's toString() value.
+     */
+    class JavaObjectSerializer
+    {
+    protected:
+        struct BoxedType
+        {
+            const char* className;
+            uint64_t serialVersionUid;
+            char typeCode; // Field type code of the "value" field
+            bool isNumber; // Subclass of java.lang.Number
+        };
+        static const BoxedType s_boxedTypes[];
+        static const char* s_stringClassName;
+
+    public:
+        static bool isSupported(const std::string& javaClassName);
+        static proton::binary serialize(const std::string& javaClassName, const std::string& valAsString);
+        // Return the class name of the serialized object, and its toString() value in valAsString
+        static std::string deserialize(const proton::binary& bytes, std::string& valAsString);
+
+    protected:
+        static const BoxedType* findBoxedType(const std::string& javaClassName);
+        static void writeValue(proton::binary& out, const BoxedType& type, const std::string& valAsString);
+        static std::string readValue(const proton::binary& bytes, std::size_t& pos, const BoxedType& type);
+        static std::string toJavaString(double d, bool isFloat);
+
+        static std::string utf8ToModifiedUtf8(const std::string& str);
+        static std::string modifiedUtf8ToUtf8(const std::string& str);
+    };
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_JAVAOBJECTSERIALIZER_HPP_ */
@@ -21,15 +21,29 @@
 
 #include "JmsTestBase.hpp"
 
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 #include <proton/connection.hpp>
 #include <proton/error_condition.hpp>
+#include <qpidit/Crc32c.hpp>
+#include <qpidit/JavaObjectSerializer.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <unistd.h>
 
 namespace qpidit {
 
     // static
     proton::symbol JmsTestBase::s_jmsMessageTypeAnnotationKey("x-opt-jms-msg-type");
     std::map<std::string, int8_t>JmsTestBase::s_jmsMessageTypeAnnotationValues = initializeJmsMessageTypeAnnotationMap();
+    const char* JmsTestBase::s_javaObjUtilsJar = "target/JavaObjUtils.jar";
+    const char* JmsTestBase::s_javaObjCacheEnvVar = "QPIDIT_JAVA_OBJ_CACHE";
+    std::map<std::string, proton::binary> JmsTestBase::s_javaObjectCache;
 
     JmsTestBase::JmsTestBase() {}
 
@@ -68,4 +82,121 @@ namespace qpidit {
         return m;
     }
 
+    // static
+    proton::binary JmsTestBase::getJavaObjectBinary(const std::string& javaClassName, const std::string& valAsString) {
+        if (JavaObjectSerializer::isSupported(javaClassName)) {
+            return JavaObjectSerializer::serialize(javaClassName, valAsString);
+        }
+        const std::string javaClassStr = javaClassName + ":" + valAsString;
+        std::map<std::string, proton::binary>::const_iterator i = s_javaObjectCache.find(javaClassStr);
+        if (i != s_javaObjectCache.end()) {
+            return i->second;
+        }
+        proton::binary javaObjectBinary;
+        const std::string fileName = javaObjectCacheFileName(javaClassStr);
+        if (fileName.empty() || !readJavaObjectCacheFile(fileName, javaClassStr, javaObjectBinary)) {
+            javaObjectBinary = runJavaObjToBytes(javaClassStr);
+            if (!fileName.empty()) {
+                writeJavaObjectCacheFile(fileName, javaClassStr, javaObjectBinary);
+            }
+        }
+        s_javaObjectCache[javaClassStr] = javaObjectBinary;
+        return javaObjectBinary;
+    }
+
+    // static
+    std::string JmsTestBase::javaObjectCacheFileName(const std::string& javaClassStr) {
+        const char* cacheDir = std::getenv(s_javaObjCacheEnvVar);
+        if (cacheDir == 0 || *cacheDir == '\0') return std::string();
+        // The class and value are checked when the file is read, so a checksum collision only costs a JVM run
+        std::ostringstream oss;
+        oss << cacheDir << "/" << javaClassStr.substr(0, javaClassStr.find(':')) << "-" << std::hex << std::setw(8)
+            << std::setfill('0') << Crc32c::compute(javaClassStr.data(), javaClassStr.size()) << ".ser";
+        return oss.str();
+    }
+
+    // static
+    bool JmsTestBase::readJavaObjectCacheFile(const std::string& fileName, const std::string& javaClassStr, proton::binary& bin) {
+        // File format: "<class>:<value>" as a length-prefixed line, then the serialized bytes
+        std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+        if (!in.good()) return false;
+        std::string::size_type keyLen = 0;
+        in >> keyLen;
+        if (!in.good() || keyLen != javaClassStr.size() || in.get() != '\n') return false;
+        std::string key(keyLen, '\0');
+        if (!in.read(&key[0], keyLen) || key != javaClassStr || in.get() != '\n') return false;
+        bin.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return !bin.empty();
+    }
+
+    // static
+    void JmsTestBase::writeJavaObjectCacheFile(const std::string& fileName, const std::string& javaClassStr, const proton::binary& bin) {
+        // Write to a temporary file and rename it, so that concurrent shims never see a partial file. The cache is
+        // only an optimization, so failures are ignored.
+        std::ostringstream tmpName;
+        tmpName << fileName << "." << ::getpid() << ".tmp";
+        {
+            std::ofstream out(tmpName.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!out.good()) return;
+            out << javaClassStr.size() << '\n' << javaClassStr << '\n';
+            out.write((const char*)&bin[0], bin.size());
+            if (!out.good()) {
+                out.close();
+                std::remove(tmpName.str().c_str());
+                return;
+            }
+        }
+        if (std::rename(tmpName.str().c_str(), fileName.c_str()) != 0) {
+            std::remove(tmpName.str().c_str());
+        }
+    }
+
+    // static
+    proton::binary JmsTestBase::runJavaObjToBytes(const std::string& javaClassStr) {
+        // JavaObjToBytes echoes its argument on the first line of output, then prints the serialized bytes in hex
+        std::ostringstream cmd;
+        cmd << "java -cp " << s_javaObjUtilsJar << " org.apache.qpid.interop_test.obj_util.JavaObjToBytes "
+            << shellQuote(javaClassStr);
+        FILE* fp = ::popen(cmd.str().c_str(), "r");
+        if (fp == NULL) { throw qpidit::PopenError(errno); }
+        std::string output;
+        char buf[1024];
+        std::size_t bytesRead;
+        while ((bytesRead = std::fread(buf, 1, sizeof(buf), fp)) > 0) {
+            output.append(buf, bytesRead);
+        }
+        int status = ::pclose(fp);
+        if (status == -1) {
+            throw qpidit::PcloseError(errno);
+        }
+        const std::string::size_type eol = output.find('\n');
+        if (status != 0 || eol == std::string::npos || output.compare(0, eol, javaClassStr) != 0) {
+            throw qpidit::JavaObjectSerializationError(javaClassStr, output);
+        }
+        std::string hex = output.substr(eol + 1);
+        while (!hex.empty() && (hex[hex.size()-1] == '\n' || hex[hex.size()-1] == '\r')) {
+            hex.erase(hex.size()-1);
+        }
+        if (hex.empty() || hex.size() % 2 != 0 || hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+            throw qpidit::JavaObjectSerializationError(javaClassStr, output);
+        }
+        proton::binary javaObjectBinary;
+        javaObjectBinary.reserve(hex.size() / 2);
+        for (std::string::size_type i=0; i<hex.size(); i+=2) {
+            javaObjectBinary.push_back((uint8_t)std::strtoul(hex.substr(i, 2).c_str(), 0, 16));
+        }
+        return javaObjectBinary;
+    }
+
+    // static
+    std::string JmsTestBase::shellQuote(const std::string& str) {
+        std::string quoted("'");
+        for (std::string::const_iterator i=str.begin(); i!=str.end(); ++i) {
+            if (*i == '\'') quoted.append("'\\''");
+            else quoted.push_back(*i);
+        }
+        quoted.push_back('\'');
+        return quoted;
+    }
+
 }
@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <map>
+#include <proton/binary.hpp>
 #include <proton/messaging_handler.hpp>
 #include <proton/symbol.hpp>
 #include <proton/transport.hpp>
@@ -45,10 +46,22 @@ namespace qpidit
                   JMS_TEXTMESSAGE_TYPE}
     jmsMessageType_t;
 
+    /*
+     * Base class for JMS senders and receivers.
+     *
+     * JMS ObjectMessage bodies are Java-serialized objects. The java.lang boxed types and String are encoded and
+     * decoded directly by JavaObjectSerializer; other classes are obtained from the JavaObjToBytes utility in
+     * JavaObjUtils.jar. Starting a JVM takes hundreds of ms, so getJavaObjectBinary() runs it only once for each
+     * class and value: results are cached in memory, and also on disk when the QPIDIT_JAVA_OBJ_CACHE environment
+     * variable names a cache directory, so that later shim runs need not start a JVM at all.
+     */
     class JmsTestBase: public proton::messaging_handler {
     protected:
         static proton::symbol s_jmsMessageTypeAnnotationKey;
         static std::map<std::string, int8_t>s_jmsMessageTypeAnnotationValues;
+        static const char* s_javaObjUtilsJar;
+        static const char* s_javaObjCacheEnvVar;
+        static std::map<std::string, proton::binary> s_javaObjectCache; // By "<class>:<value>"
     public:
         JmsTestBase();
         virtual ~JmsTestBase();
@@ -60,6 +73,14 @@ namespace qpidit
         void on_error(const proton::error_condition &c);
     protected:
         static std::map<std::string, int8_t> initializeJmsMessageTypeAnnotationMap();
+
+        // Return the Java serialized bytes of an object of class javaClassName constructed from valAsString
+        static proton::binary getJavaObjectBinary(const std::string& javaClassName, const std::string& valAsString);
+        static std::string javaObjectCacheFileName(const std::string& javaClassStr);
+        static bool readJavaObjectCacheFile(const std::string& fileName, const std::string& javaClassStr, proton::binary& bin);
+        static void writeJavaObjectCacheFile(const std::string& fileName, const std::string& javaClassStr, const proton::binary& bin);
+        static proton::binary runJavaObjToBytes(const std::string& javaClassStr);
+        static std::string shellQuote(const std::string& str);
     };
 
 } // namespace qpidit
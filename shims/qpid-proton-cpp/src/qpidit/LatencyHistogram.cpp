@@ -0,0 +1,114 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/LatencyHistogram.hpp"
+
+#include <cstring>
+
+namespace qpidit
+{
+
+    LatencyHistogram::LatencyHistogram() {
+        reset();
+    }
+
+    LatencyHistogram::~LatencyHistogram() {}
+
+    void LatencyHistogram::record(uint64_t valueNs) {
+        __atomic_fetch_add(&_counts[bucketIndex(valueNs)], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&_totalCount, 1, __ATOMIC_RELAXED);
+        uint64_t current = __atomic_load_n(&_min, __ATOMIC_RELAXED);
+        while (valueNs < current && !__atomic_compare_exchange_n(&_min, &current, valueNs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+        current = __atomic_load_n(&_max, __ATOMIC_RELAXED);
+        while (valueNs > current && !__atomic_compare_exchange_n(&_max, &current, valueNs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    }
+
+    void LatencyHistogram::reset() {
+        std::memset(_counts, 0, sizeof(_counts));
+        _totalCount = 0;
+        _min = ~uint64_t(0);
+        _max = 0;
+    }
+
+    uint64_t LatencyHistogram::count() const {
+        return _totalCount;
+    }
+
+    uint64_t LatencyHistogram::min() const {
+        return _totalCount == 0 ? 0 : _min;
+    }
+
+    uint64_t LatencyHistogram::max() const {
+        return _max;
+    }
+
+    uint64_t LatencyHistogram::percentile(double pct) const {
+        if (_totalCount == 0) return 0;
+        uint64_t countAtPct = uint64_t(pct / 100.0 * _totalCount + 0.5);
+        if (countAtPct == 0) countAtPct = 1;
+        uint64_t runningCount = 0;
+        for (unsigned i=0; i<s_numBuckets; ++i) {
+            runningCount += _counts[i];
+            if (runningCount >= countAtPct) {
+                const uint64_t value = bucketHighestValue(i);
+                return value < _max ? value : _max;
+            }
+        }
+        return _max;
+    }
+
+    Json::Value LatencyHistogram::toJson() const {
+        Json::Value summary(Json::objectValue);
+        summary["count"] = Json::UInt64(count());
+        summary["min"] = Json::UInt64(min() / 1000);
+        summary["p50"] = Json::UInt64(percentile(50.0) / 1000);
+        summary["p90"] = Json::UInt64(percentile(90.0) / 1000);
+        summary["p99"] = Json::UInt64(percentile(99.0) / 1000);
+        summary["p99.9"] = Json::UInt64(percentile(99.9) / 1000);
+        summary["max"] = Json::UInt64(max() / 1000);
+        return summary;
+    }
+
+    // protected
+
+    //static
+    unsigned LatencyHistogram::bucketIndex(uint64_t value) {
+        if (value < s_subBucketCount) {
+            return unsigned(value);
+        }
+        const unsigned magnitude = 63 - __builtin_clzll(value); // >= s_subBucketBits
+        const unsigned shift = magnitude - s_subBucketBits;
+        const unsigned subBucket = unsigned(value >> shift) - s_subBucketCount;
+        return s_subBucketCount * (shift + 1) + subBucket;
+    }
+
+    //static
+    uint64_t LatencyHistogram::bucketHighestValue(unsigned index) {
+        if (index < s_subBucketCount) {
+            return index;
+        }
+        const unsigned shift = index / s_subBucketCount - 1;
+        const uint64_t subBucket = index % s_subBucketCount;
+        const uint64_t lowest = (s_subBucketCount + subBucket) << shift;
+        return lowest + ((uint64_t(1) << shift) - 1);
+    }
+
+} /* namespace qpidit */
@@ -0,0 +1,71 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_LATENCYHISTOGRAM_HPP_
+#define SRC_QPIDIT_LATENCYHISTOGRAM_HPP_
+
+#include <json/value.h>
+#include <stdint.h>
+
+namespace qpidit
+{
+
+    /*
+     * Fixed-size log-linear histogram of latency values (in ns), after the style of HdrHistogram. Values
+     * below 2^s_subBucketBits are counted exactly; above that, each power of two is split into
+     * 2^s_subBucketBits equal sub-buckets, giving a worst-case error of about 3% over the whole uint64_t
+     * range. Recording is a single relaxed atomic increment (plus min/max updates), so no lock is needed
+     * when recording from more than one thread.
+     */
+    class LatencyHistogram
+    {
+    public:
+        static const unsigned s_subBucketBits = 5;
+        static const unsigned s_subBucketCount = 1U << s_subBucketBits;
+        static const unsigned s_numBuckets = s_subBucketCount * (64 - s_subBucketBits + 1);
+    protected:
+        uint64_t _counts[s_numBuckets];
+        uint64_t _totalCount;
+        uint64_t _min;
+        uint64_t _max;
+    public:
+        LatencyHistogram();
+        virtual ~LatencyHistogram();
+
+        void record(uint64_t valueNs);
+        void reset();
+
+        uint64_t count() const;
+        uint64_t min() const;
+        uint64_t max() const;
+        uint64_t percentile(double pct) const;
+
+        // Summary in us: {"count": N, "min": .., "p50": .., "p90": .., "p99": .., "p99.9": .., "max": ..}
+        Json::Value toJson() const;
+
+    protected:
+        static unsigned bucketIndex(uint64_t value);
+        static uint64_t bucketHighestValue(unsigned index);
+    };
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_LATENCYHISTOGRAM_HPP_ */
@@ -0,0 +1,62 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_MUTEX_HPP_
+#define SRC_QPIDIT_MUTEX_HPP_
+
+#include <pthread.h>
+
+namespace qpidit
+{
+
+    /*
+     * Minimal non-recursive mutex for state shared between the threads of a multi-threaded
+     * proton::container (see the --threads option).
+     */
+    class Mutex
+    {
+    protected:
+        pthread_mutex_t _mutex;
+    public:
+        class ScopedLock
+        {
+        protected:
+            Mutex& _m;
+        public:
+            explicit ScopedLock(Mutex& m) : _m(m) { _m.lock(); }
+            ~ScopedLock() { _m.unlock(); }
+        private:
+            ScopedLock(const ScopedLock&);
+            ScopedLock& operator=(const ScopedLock&);
+        };
+
+        Mutex() { ::pthread_mutex_init(&_mutex, 0); }
+        ~Mutex() { ::pthread_mutex_destroy(&_mutex); }
+        void lock() { ::pthread_mutex_lock(&_mutex); }
+        void unlock() { ::pthread_mutex_unlock(&_mutex); }
+    private:
+        Mutex(const Mutex&);
+        Mutex& operator=(const Mutex&);
+    };
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_MUTEX_HPP_ */
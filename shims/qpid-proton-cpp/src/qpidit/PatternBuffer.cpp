@@ -0,0 +1,54 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/PatternBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace qpidit
+{
+
+    PatternBuffer::PatternBuffer() : _buffer() {}
+
+    PatternBuffer::~PatternBuffer() {}
+
+    const char* PatternBuffer::data(std::size_t size) {
+        if (_buffer.size() < size || _buffer.empty()) {
+            _buffer.resize(size > 0 ? size : 1);
+            fill(&_buffer[0], _buffer.size());
+        }
+        return &_buffer[0];
+    }
+
+    //static
+    void PatternBuffer::fill(char* buf, std::size_t size) {
+        static const char pattern[] = "abcdefghijklmnopqrstuvwxyz";
+        std::size_t filled = std::min(size, sizeof(pattern) - 1);
+        std::memcpy(buf, pattern, filled);
+        while (filled < size) {
+            const std::size_t n = std::min(filled, size - filled);
+            std::memcpy(buf + filled, buf, n);
+            filled += n;
+        }
+    }
+
+} /* namespace qpidit */
@@ -0,0 +1,53 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_PATTERNBUFFER_HPP_
+#define SRC_QPIDIT_PATTERNBUFFER_HPP_
+
+#include <cstddef>
+#include <vector>
+
+namespace qpidit
+{
+
+    /*
+     * Buffer containing the repeating pattern "abc...xyzabc..." used as large content test data. The
+     * pattern is written in bulk by copying the filled part of the buffer onto the unfilled part,
+     * doubling the filled size each time. The buffer only grows, and as any prefix of the pattern is
+     * itself a valid test value, it is reused for all sizes up to the largest requested.
+     */
+    class PatternBuffer
+    {
+    protected:
+        std::vector<char> _buffer;
+    public:
+        PatternBuffer();
+        virtual ~PatternBuffer();
+
+        // Return a pointer to at least size bytes of the pattern
+        const char* data(std::size_t size);
+
+        static void fill(char* buf, std::size_t size);
+    };
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_PATTERNBUFFER_HPP_ */
@@ -87,6 +87,15 @@ namespace qpidit
     IncorrectMessageBodyTypeError::~IncorrectMessageBodyTypeError() throw() {}
 
 
+    // --- IncorrectTestPatternError ---
+
+    IncorrectTestPatternError::IncorrectTestPatternError(const std::string& context, size_t offset) :
+                    std::runtime_error(MSG(context << ": Test pattern mismatch at byte offset " << offset))
+    {}
+
+    IncorrectTestPatternError::~IncorrectTestPatternError() throw() {}
+
+
     // --- IncorrectValueTypeError ---
     // TODO: Consolidate with IncorrectMessageBodyTypeError?
 
@@ -140,6 +149,15 @@ namespace qpidit
     InvalidTestValueError::~InvalidTestValueError() throw() {}
 
 
+    // --- JavaObjectSerializationError ---
+
+    JavaObjectSerializationError::JavaObjectSerializationError(const std::string& javaClassStr, const std::string& details) :
+                    std::runtime_error(MSG("Java object serialization of \"" << javaClassStr << "\" failed: " << details))
+    {}
+
+    JavaObjectSerializationError::~JavaObjectSerializationError() throw() {}
+
+
     // --- JsonParserError ---
 
     JsonParserError::JsonParserError(const Json::Reader& jsonReader) :
@@ -149,6 +167,16 @@ namespace qpidit
     JsonParserError::~JsonParserError() throw() {}
 
 
+    // --- LoopbackStalledError ---
+
+    LoopbackStalledError::LoopbackStalledError(const std::string& amqpType, uint32_t expected, uint32_t received) :
+                    std::runtime_error(MSG("Loopback connection for AMQP type \"" << amqpType << "\" stopped after "
+                                    << received << " of " << expected << " messages"))
+    {}
+
+    LoopbackStalledError::~LoopbackStalledError() throw() {}
+
+
     // --- PcloseError ---
 
     PcloseError::PcloseError(int errorNum) : ErrnoError("pclose", errorNum) {}
@@ -86,6 +86,13 @@ namespace qpidit
         virtual ~IncorrectMessageBodyTypeError() throw();
     };
 
+    class IncorrectTestPatternError: public std::runtime_error
+    {
+    public:
+        IncorrectTestPatternError(const std::string& context, size_t offset);
+        virtual ~IncorrectTestPatternError() throw();
+    };
+
     class IncorrectValueTypeError: public std::runtime_error
     {
     public:
@@ -112,6 +119,13 @@ namespace qpidit
         virtual ~InvalidTestValueError() throw();
     };
 
+    class JavaObjectSerializationError: public std::runtime_error
+    {
+    public:
+        JavaObjectSerializationError(const std::string& javaClassStr, const std::string& details);
+        virtual ~JavaObjectSerializationError() throw();
+    };
+
     class JsonParserError: public std::runtime_error
     {
     public:
@@ -119,6 +133,13 @@ namespace qpidit
         virtual ~JsonParserError() throw();
     };
 
+    class LoopbackStalledError: public std::runtime_error
+    {
+    public:
+        LoopbackStalledError(const std::string& amqpType, uint32_t expected, uint32_t received);
+        virtual ~LoopbackStalledError() throw();
+    };
+
     class PcloseError: public ErrnoError
     {
     public:
@@ -0,0 +1,144 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/ShimArgs.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <json/reader.h>
+#include <qpidit/QpidItErrors.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace qpidit
+{
+
+    ShimArgs::ShimArgs(int argc, char** argv) :
+                    _options(),
+                    _args()
+    {
+        bool optionsFlag = true;
+        for (int i=1; i<argc; ++i) {
+            const std::string a(argv[i]);
+            if (optionsFlag && a.compare("--") == 0) {
+                optionsFlag = false;
+            } else if (optionsFlag && a.size() > 2 && a.compare(0, 2, "--") == 0) {
+                const std::string::size_type eqPos = a.find('=');
+                if (eqPos == std::string::npos) {
+                    _options[a.substr(2)] = "";
+                } else {
+                    _options[a.substr(2, eqPos - 2)] = a.substr(eqPos + 1);
+                }
+            } else {
+                // Options end at the first positional argument
+                optionsFlag = false;
+                _args.push_back(a);
+            }
+        }
+    }
+
+    ShimArgs::~ShimArgs() {}
+
+    bool ShimArgs::hasOption(const std::string& name) const {
+        return _options.find(name) != _options.end();
+    }
+
+    std::string ShimArgs::getOption(const std::string& name, const std::string& defaultValue) const {
+        std::map<std::string, std::string>::const_iterator i = _options.find(name);
+        if (i == _options.end()) return defaultValue;
+        return i->second;
+    }
+
+    uint32_t ShimArgs::getUintOption(const std::string& name, uint32_t defaultValue) const {
+        std::map<std::string, std::string>::const_iterator i = _options.find(name);
+        if (i == _options.end()) return defaultValue;
+        // strtoul() would accept leading space and signs, and wrap negative values
+        if (i->second.empty() || !std::isdigit(static_cast<unsigned char>(i->second[0]))) {
+            throw qpidit::ArgumentError(MSG("Option --" << name << ": invalid unsigned integer value \"" << i->second << "\""));
+        }
+        char* endPtr;
+        errno = 0;
+        const unsigned long val = std::strtoul(i->second.c_str(), &endPtr, 0);
+        if (*endPtr != '\0') {
+            throw qpidit::ArgumentError(MSG("Option --" << name << ": invalid unsigned integer value \"" << i->second << "\""));
+        }
+        if (errno == ERANGE || val > 0xffffffffUL) {
+            throw qpidit::ArgumentError(MSG("Option --" << name << ": value \"" << i->second << "\" out of range"));
+        }
+        return uint32_t(val);
+    }
+
+    size_t ShimArgs::numArgs() const {
+        return _args.size();
+    }
+
+    const std::string& ShimArgs::arg(size_t index) const {
+        if (index >= _args.size()) {
+            throw qpidit::ArgumentError(MSG("Missing argument " << (index + 1)));
+        }
+        return _args[index];
+    }
+
+    void ShimArgs::jsonArg(size_t index, Json::Value& value) const {
+        parseJson(arg(index), value);
+    }
+
+    //static
+    void ShimArgs::parseJson(const std::string& src, Json::Value& value) {
+        Json::Reader jsonReader;
+        bool parsedFlag;
+        if (src.compare("-") == 0) {
+            parsedFlag = jsonReader.parse(std::cin, value, false);
+        } else if (src.size() > 1 && src[0] == '@') {
+            const std::string fileName(src.substr(1));
+            const int fd = ::open(fileName.c_str(), O_RDONLY);
+            if (fd < 0) { throw qpidit::ErrnoError(MSG("open(\"" << fileName << "\")"), errno); }
+            struct stat st;
+            if (::fstat(fd, &st) < 0) {
+                const int e = errno;
+                ::close(fd);
+                throw qpidit::ErrnoError("fstat", e);
+            }
+            if (st.st_size == 0) {
+                ::close(fd);
+                throw qpidit::ArgumentError(MSG("JSON file \"" << fileName << "\" is empty"));
+            }
+            void* addr = ::mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            const int e = errno;
+            ::close(fd);
+            if (addr == MAP_FAILED) { throw qpidit::ErrnoError("mmap", e); }
+            ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            const char* begin = static_cast<const char*>(addr);
+            parsedFlag = jsonReader.parse(begin, begin + st.st_size, value, false);
+            ::munmap(addr, st.st_size);
+        } else {
+            parsedFlag = jsonReader.parse(src, value, false);
+        }
+        if (!parsedFlag) {
+            throw qpidit::JsonParserError(jsonReader);
+        }
+    }
+
+} /* namespace qpidit */
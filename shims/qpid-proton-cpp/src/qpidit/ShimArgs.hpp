@@ -0,0 +1,69 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_SHIMARGS_HPP_
+#define SRC_QPIDIT_SHIMARGS_HPP_
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Json
+{
+    class Value;
+}
+
+namespace qpidit
+{
+
+    /*
+     * Shim command-line arguments. Options of the form --name or --name=value may precede the
+     * positional arguments, so that the test program can pass shim-specific options without
+     * changing the positional arguments common to all shims.
+     *
+     * JSON arguments may be given inline, as "-" to read them from stdin, or as "@path" to read them
+     * from a file, which is memory-mapped and parsed in place. This keeps large test vectors off the
+     * command line.
+     */
+    class ShimArgs
+    {
+    protected:
+        std::map<std::string, std::string> _options;
+        std::vector<std::string> _args;
+    public:
+        ShimArgs(int argc, char** argv);
+        virtual ~ShimArgs();
+
+        bool hasOption(const std::string& name) const;
+        std::string getOption(const std::string& name, const std::string& defaultValue = "") const;
+        uint32_t getUintOption(const std::string& name, uint32_t defaultValue) const;
+
+        size_t numArgs() const;
+        const std::string& arg(size_t index) const;
+        void jsonArg(size_t index, Json::Value& value) const;
+
+        static void parseJson(const std::string& src, Json::Value& value);
+    };
+
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_SHIMARGS_HPP_ */
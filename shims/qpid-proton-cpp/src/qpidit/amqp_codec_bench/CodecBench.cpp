@@ -0,0 +1,168 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/amqp_codec_bench/CodecBench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <json/json.h>
+#include <qpidit/QpidItErrors.hpp>
+#include <stdlib.h> // exit()
+
+namespace qpidit
+{
+    namespace amqp_codec_bench
+    {
+
+        // --- CodecBench::TypesSender ---
+
+        CodecBench::TypesSender::TypesSender(const std::string& amqpType, const Json::Value& testValues) :
+                        amqp_types_test::Sender("codec-bench", "codec-bench", amqpType, testValues)
+        {}
+
+        void CodecBench::TypesSender::encode(proton::message& msg, uint64_t msgId, const Json::Value& testValue) {
+            setMessage(msg, msgId, testValue);
+        }
+
+
+        // --- CodecBench::TypesReceiver ---
+
+        CodecBench::TypesReceiver::TypesReceiver(const std::string& amqpType, uint32_t expected) :
+                        amqp_types_test::Receiver("codec-bench", "codec-bench", amqpType, expected)
+        {}
+
+        void CodecBench::TypesReceiver::decode(const proton::message& msg) {
+            (this->*s_decodeFns[_amqpTypeId])(msg);
+        }
+
+        const Json::Value& CodecBench::TypesReceiver::resultValues() const {
+            return _resultValueList;
+        }
+
+        void CodecBench::TypesReceiver::clearResultValues() {
+            _resultValueList.clear();
+        }
+
+
+        // --- CodecBench ---
+
+        CodecBench::CodecBench(const ShimArgs& args) :
+                        BenchBase(args, 100),
+                        _warmup(args.getUintOption("warmup", 10))
+        {}
+
+        CodecBench::~CodecBench() {}
+
+        // protected
+
+        Json::Value CodecBench::runType(const std::string& amqpType, const Json::Value& testValues) {
+            const size_t numValues = testValues.size();
+            TypesSender sender(amqpType, testValues);
+            TypesReceiver receiver(amqpType, numValues);
+            std::vector<proton::message> sent(numValues);
+            std::vector<proton::message> received(numValues);
+            std::vector<char> wireBuffer;
+            std::vector<double> encodeNs;
+            std::vector<double> wireNs;
+            std::vector<double> decodeNs;
+            bool roundTrip = true;
+
+            for (uint32_t pass = 0; pass < _warmup + _repeat; ++pass) {
+                const bool timed = pass >= _warmup;
+
+                int64_t startNs = nowNs();
+                Json::Value::const_iterator itr = testValues.begin();
+                for (size_t i = 0; i < numValues; ++i, ++itr) {
+                    sender.encode(sent[i], i + 1, *itr);
+                }
+                if (timed) encodeNs.push_back(double(nowNs() - startNs) / numValues);
+
+                startNs = nowNs();
+                for (size_t i = 0; i < numValues; ++i) {
+                    sent[i].encode(wireBuffer);
+                    received[i].decode(wireBuffer);
+                }
+                if (timed) wireNs.push_back(double(nowNs() - startNs) / numValues);
+
+                receiver.clearResultValues();
+                startNs = nowNs();
+                for (size_t i = 0; i < numValues; ++i) {
+                    receiver.decode(received[i]);
+                }
+                if (timed) decodeNs.push_back(double(nowNs() - startNs) / numValues);
+
+                if (pass == 0) {
+                    // The values must come back as they were sent, as the amqp_types_test test program checks
+                    roundTrip = receiver.resultValues() == testValues;
+                }
+            }
+
+            Json::Value result(Json::objectValue);
+            result["type"] = amqpType;
+            result["values"] = Json::UInt(numValues);
+            result["repeat"] = _repeat;
+            result["round_trip"] = roundTrip;
+            if (numValues > 0) {
+                result["encode_ns"] = summarize(encodeNs);
+                result["wire_ns"] = summarize(wireNs);
+                result["decode_ns"] = summarize(decodeNs);
+            }
+            return result;
+        }
+
+        //static
+        Json::Value CodecBench::summarize(std::vector<double>& samples) {
+            std::sort(samples.begin(), samples.end());
+            double sum = 0.0;
+            for (std::vector<double>::const_iterator i = samples.begin(); i != samples.end(); ++i) {
+                sum += *i;
+            }
+            const double mean = sum / samples.size();
+            double sumSquares = 0.0;
+            for (std::vector<double>::const_iterator i = samples.begin(); i != samples.end(); ++i) {
+                sumSquares += (*i - mean) * (*i - mean);
+            }
+            Json::Value summary(Json::objectValue);
+            summary["min"] = samples.front();
+            summary["p50"] = samples[samples.size() / 2];
+            summary["mean"] = mean;
+            summary["stddev"] = std::sqrt(sumSquares / samples.size());
+            summary["max"] = samples.back();
+            return summary;
+        }
+
+    } /* namespace amqp_codec_bench */
+} /* namespace qpidit */
+
+
+/*
+ * --- main ---
+ * Args: 1: Test values as a JSON map of AMQP type to a list of values (in the form used by the amqp_types_test
+ *          Sender), "-" to read it from stdin or "@file" to read it from a file
+ * Options: --warmup=N: Untimed passes over the test values before timing starts (default 10)
+ *          --repeat=N: Timed passes over the test values (default 100)
+ * Output: One JSON map per AMQP type containing the number of values, whether they round-tripped unchanged,
+ *         and the summary of the time per value (ns) of each phase
+ */
+
+int main(int argc, char** argv) {
+    exit(qpidit::BenchBase::main<qpidit::amqp_codec_bench::CodecBench>(argc, argv, "amqp_codec_bench"));
+}
@@ -0,0 +1,78 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQP_CODEC_BENCH_CODECBENCH_HPP_
+#define SRC_QPIDIT_AMQP_CODEC_BENCH_CODECBENCH_HPP_
+
+#include <proton/message.hpp>
+#include <qpidit/BenchBase.hpp>
+#include <qpidit/amqp_types_test/Receiver.hpp>
+#include <qpidit/amqp_types_test/Sender.hpp>
+#include <vector>
+
+namespace qpidit
+{
+    namespace amqp_codec_bench
+    {
+
+        /*
+         * Times the amqp_types_test conversions for each AMQP type in isolation, in three phases:
+         *   encode: Sender::setMessage(), JSON test value to proton::message
+         *   wire:   proton::message encode to bytes and decode again (the proton codec, as done by a broker hop)
+         *   decode: the Receiver's per-type decode, proton::message to JSON result value
+         * Each phase is run over all the test values for the type --warmup times untimed, then --repeat times
+         * timed. The time per value of each timed pass is summarized as min, p50, mean, stddev and max in ns.
+         */
+        class CodecBench : public BenchBase
+        {
+        protected:
+            // Expose the protected per-message conversions of the amqp_types_test shims
+            class TypesSender : public amqp_types_test::Sender
+            {
+            public:
+                TypesSender(const std::string& amqpType, const Json::Value& testValues);
+                void encode(proton::message& msg, uint64_t msgId, const Json::Value& testValue);
+            };
+
+            class TypesReceiver : public amqp_types_test::Receiver
+            {
+            public:
+                TypesReceiver(const std::string& amqpType, uint32_t expected);
+                void decode(const proton::message& msg);
+                const Json::Value& resultValues() const;
+                void clearResultValues();
+            };
+
+            const uint32_t _warmup;
+        public:
+            CodecBench(const ShimArgs& args);
+            virtual ~CodecBench();
+        protected:
+            Json::Value runType(const std::string& amqpType, const Json::Value& testValues);
+
+            // Summary of samples (sorted in place)
+            static Json::Value summarize(std::vector<double>& samples);
+        };
+
+    } /* namespace amqp_codec_bench */
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQP_CODEC_BENCH_CODECBENCH_HPP_ */
@@ -0,0 +1,37 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQP_LARGE_CONTENT_TEST_CRC32CPROPERTY_HPP_
+#define SRC_QPIDIT_AMQP_LARGE_CONTENT_TEST_CRC32CPROPERTY_HPP_
+
+namespace qpidit
+{
+    namespace amqp_large_content_test
+    {
+
+        // Application property in which the Sender sends the CRC32C of a message's content (the string, symbol
+        // or binary body, or the list or map values in order), so that the Receiver can check the content
+        const char* const s_crc32cPropertyName = "qpidit-content-crc32c";
+
+    } /* namespace amqp_large_content_test */
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQP_LARGE_CONTENT_TEST_CRC32CPROPERTY_HPP_ */
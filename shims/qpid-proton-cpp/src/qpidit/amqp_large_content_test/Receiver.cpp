@@ -21,6 +21,7 @@
 
 #include "qpidit/amqp_large_content_test/Receiver.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <json/json.h>
 #include <stdlib.h> // exit()
@@ -29,13 +30,18 @@
 #include <proton/delivery.hpp>
 #include <proton/message.hpp>
 #include <proton/receiver.hpp>
+#include <qpidit/AmqpShimServer.hpp>
 #include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
     namespace amqp_large_content_test
     {
 
+        //static
+        const uint32_t Receiver::s_defaultCreditBytes = 256 * 1024 * 1024;
+
         Receiver::Receiver(const std::string& brokerAddr,
                            const std::string& queueName,
                            const std::string& amqpType,
@@ -44,20 +50,54 @@ namespace qpidit
                         _amqpType(amqpType),
                         _expected(expected),
                         _received(0UL),
-                        _receivedValueList(Json::arrayValue)
-        {}
+                        _receivedValueList(Json::arrayValue),
+                        _patternBuffer(),
+                        _stringBuffer(),
+                        _symbolBuffer(),
+                        _binaryBuffer(),
+                        _crc32c(),
+                        _hasCrc32c(false),
+                        _patternError(),
+                        _contentBytes(0)
+        {
+            // Messages may be 100MB or more, so limit the credit by size rather than by proton's default window
+            _creditBytes = s_defaultCreditBytes;
+        }
 
         Receiver::~Receiver() {}
 
+        //static
+        qpidit::AmqpTestBase* Receiver::createJob(const std::string& brokerAddr,
+                                                  const std::string& queueName,
+                                                  const std::string& amqpType,
+                                                  const std::string& expectedStr) {
+            return new Receiver(brokerAddr, queueName, amqpType, std::strtoul(expectedStr.c_str(), NULL, 0));
+        }
+
         Json::Value& Receiver::getReceivedValueList() {
             return _receivedValueList;
         }
 
-        void Receiver::on_message(proton::delivery &d, proton::message &m) {
+        void Receiver::printResult(std::ostream& out) {
+            out << _amqpType << std::endl;
+            Json::FastWriter fw;
+            out << fw.write(_receivedValueList);
+            printLatency(out);
+        }
+
+        void Receiver::processMessage(proton::delivery &d, proton::message &m) {
             try {
                 if (_received < _expected) {
+                    // The content is checked in a single pass as it is decoded: against the CRC32C if the sender
+                    // sent one, otherwise against the test pattern
+                    _crc32c.reset();
+                    _hasCrc32c = m.properties().exists(s_crc32cPropertyName);
+                    _patternError.clear();
+                    _contentBytes = 0;
                     if (_amqpType.compare("binary") == 0 || _amqpType.compare("string") == 0 || _amqpType.compare("symbol") == 0) {
-                        _receivedValueList.append(getTestStringSizeMb(m.body()));
+                        const uint32_t sizeMb = getTestStringSizeMb(m.body());
+                        recordMessageSize(_contentBytes);
+                        _receivedValueList.append(sizeMb);
                     } else {
                         std::pair<uint32_t, uint32_t> ret;
                         if (_amqpType.compare("list") == 0) {
@@ -65,6 +105,7 @@ namespace qpidit
                         } else {
                             ret = getTestMapSizeMb(m.body());
                         }
+                        recordMessageSize(_contentBytes);
                         if (_receivedValueList.empty()) {
                             createNewListMapSize(ret);
                         } else {
@@ -83,11 +124,17 @@ namespace qpidit
                             }
                         }
                     }
+                    // The size is always recorded above; corruption is reported separately so that
+                    // every corrupted message is reported without losing its size.
+                    if (!_patternError.empty()) {
+                        std::cerr << _testName << ": message " << (_received + 1) << ": " << _patternError << std::endl;
+                    } else if (_hasCrc32c) {
+                        checkCrc32c(m);
+                    }
                 }
                 _received++;
                 if (_received >= _expected) {
-                    d.receiver().close();
-                    d.connection().close();
+                    testComplete(d.receiver());
                 }
             } catch (const std::exception&) {
                 d.receiver().close();
@@ -99,40 +146,123 @@ namespace qpidit
         // protected
 
         std::pair<uint32_t, uint32_t> Receiver::getTestListSizeMb(const proton::value& pvTestList) {
-            // Uniform elt size assumed
-            const std::vector<proton::value>& testList(proton::get<std::vector<proton::value> >(pvTestList));
-            if (testList.empty()) {
-                std::ostringstream oss;
-                oss << _testName << "::Receiver::getTestListSizeMb: List empty";
-                throw qpidit::ArgumentError(oss.str());
+            // Walk the encoded list element by element rather than decoding it into a std::vector
+            const std::string context(_testName + "::getTestListSizeMb");
+            proton::codec::decoder dec(pvTestList);
+            proton::codec::start s;
+            dec >> s;
+            if (s.type != proton::LIST) {
+                throw qpidit::IncorrectMessageBodyTypeError(proton::LIST, s.type);
+            }
+            if (s.size == 0) {
+                throw qpidit::ArgumentError(context + ": List empty");
             }
-            std::string elt = proton::get<std::string>(testList[0]);
-            uint32_t numElements = testList.size();
-            return std::pair<uint32_t, uint32_t>(numElements * elt.size() / 1024 / 1024, numElements);
+            uint64_t totSizeBytes = 0;
+            size_t eltSize = 0;
+            for (size_t i=0; i<s.size; ++i) {
+                const size_t size = checkNextTestString(dec, context);
+                if (i > 0 && size != eltSize) {
+                    throw qpidit::IncorrectMessageBodyLengthError(context, eltSize, size);
+                }
+                eltSize = size;
+                totSizeBytes += size;
+            }
+            dec >> proton::codec::finish();
+            return std::pair<uint32_t, uint32_t>(totSizeBytes / 1024 / 1024, s.size);
         }
 
         std::pair<uint32_t, uint32_t> Receiver::getTestMapSizeMb(const proton::value& pvTestMap) {
-            // Uniform elt size assumed
-            const std::map<std::string, proton::value>& testMap(proton::get<std::map<std::string, proton::value> >(pvTestMap));
-            if (testMap.empty()) {
-                std::ostringstream oss;
-                oss << _testName << "::Receiver::getTestMapSizeMb: Map empty";
-                throw qpidit::ArgumentError(oss.str());
+            // Walk the encoded map entry by entry rather than decoding it into a std::map
+            const std::string context(_testName + "::getTestMapSizeMb");
+            proton::codec::decoder dec(pvTestMap);
+            proton::codec::start s;
+            dec >> s;
+            if (s.type != proton::MAP) {
+                throw qpidit::IncorrectMessageBodyTypeError(proton::MAP, s.type);
             }
-            std::string elt = proton::get<std::string>(testMap.begin()->second);
-            uint32_t numElements = testMap.size();
-            return std::pair<uint32_t, uint32_t>(numElements * elt.size() / 1024 / 1024, numElements);
+            if (s.size == 0) {
+                throw qpidit::ArgumentError(context + ": Map empty");
+            }
+            const size_t numElements = s.size / 2; // s.size counts both keys and values
+            uint64_t totSizeBytes = 0;
+            size_t eltSize = 0;
+            for (size_t i=0; i<numElements; ++i) {
+                dec >> _stringBuffer; // key
+                const size_t size = checkNextTestString(dec, context);
+                if (i > 0 && size != eltSize) {
+                    throw qpidit::IncorrectMessageBodyLengthError(context, eltSize, size);
+                }
+                eltSize = size;
+                totSizeBytes += size;
+            }
+            dec >> proton::codec::finish();
+            return std::pair<uint32_t, uint32_t>(totSizeBytes / 1024 / 1024, numElements);
         }
 
         uint32_t Receiver::getTestStringSizeMb(const proton::value& testString) {
+            proton::type_id expectedType;
             if (_amqpType.compare("binary") == 0) {
-                return proton::get<proton::binary>(testString).size() / 1024 / 1024;
+                expectedType = proton::BINARY;
+            } else if (_amqpType.compare("string") == 0) {
+                expectedType = proton::STRING;
+            } else if (_amqpType.compare("symbol") == 0) {
+                expectedType = proton::SYMBOL;
+            } else {
+                throw qpidit::UnknownAmqpTypeError(_amqpType);
+            }
+            proton::codec::decoder dec(testString);
+            if (dec.next_type() != expectedType) {
+                throw qpidit::IncorrectMessageBodyTypeError(expectedType, dec.next_type());
+            }
+            return checkNextTestString(dec, _testName + "::getTestStringSizeMb") / 1024 / 1024;
+        }
+
+        size_t Receiver::checkNextTestString(proton::codec::decoder& dec, const std::string& context) {
+            // Decode the next string, symbol or binary into its reused buffer, check its content, return its size
+            const proton::type_id type = dec.next_type();
+            switch (type) {
+            case proton::STRING:
+                dec >> _stringBuffer;
+                checkContent(_stringBuffer.data(), _stringBuffer.size(), context);
+                return _stringBuffer.size();
+            case proton::SYMBOL:
+                dec >> _symbolBuffer;
+                checkContent(_symbolBuffer.data(), _symbolBuffer.size(), context);
+                return _symbolBuffer.size();
+            case proton::BINARY:
+                dec >> _binaryBuffer;
+                if (!_binaryBuffer.empty()) {
+                    checkContent(reinterpret_cast<const char*>(&_binaryBuffer[0]), _binaryBuffer.size(), context);
+                }
+                return _binaryBuffer.size();
+            default:
+                throw qpidit::IncorrectMessageBodyTypeError(proton::STRING, type);
+            }
+        }
+
+        void Receiver::checkCrc32c(const proton::message& msg) {
+            const uint32_t expected = proton::get<uint32_t>(msg.properties().get(s_crc32cPropertyName));
+            if (_crc32c.value() != expected) {
+                std::cerr << _testName << ": message " << (_received + 1) << ": Content CRC32C mismatch: expected 0x"
+                          << std::hex << expected << "; found 0x" << _crc32c.value() << std::dec << std::endl;
             }
-            if (_amqpType.compare("string") == 0) {
-                return proton::get<std::string>(testString).size() / 1024 / 1024;
+        }
+
+        void Receiver::checkContent(const char* data, size_t size, const std::string& context) {
+            _contentBytes += size;
+            if (_hasCrc32c) {
+                _crc32c.update(data, size);
+                return;
             }
-            if (_amqpType.compare("symbol") == 0) {
-                return proton::get<proton::symbol>(testString).size() / 1024 / 1024;
+            const char* pattern = _patternBuffer.data(size);
+            if (std::memcmp(data, pattern, size) == 0) return;
+            // Senders which send no CRC32C fill their content with either the test pattern, or (the AmqpNetLite
+            // shim) a single repeated character
+            if (std::memcmp(data, data + 1, size - 1) == 0) return;
+            if (_patternError.empty()) {
+                size_t offset = 0;
+                while (data[offset] == pattern[offset]) ++offset;
+                _patternError = qpidit::IncorrectTestPatternError(context, offset).what();
             }
         }
 
@@ -153,30 +283,40 @@ namespace qpidit
 } /* namespace qpidit */
 
 
+#ifndef QPIDIT_SHIM_NO_MAIN // Defined when linked into another program, eg amqp_loopback_bench
+
 /*
  * --- main ---
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: AMQP type
  *       4: Expected number of test values to receive
+ * Options: --server: Run as a persistent shim server (see AmqpShimServer); only arg 1 is used
+ *          --latency: Record the latency of timestamped messages, printed as a third line of output
+ *          --listen: Listen on arg 1 for a sender to connect directly, rather than connecting to a broker
  */
 
 int main(int argc, char** argv) {
-    // TODO: improve arg management a little...
-    if (argc != 5) {
-        throw qpidit::ArgumentError("Incorrect number of arguments");
-    }
-
     try {
-        qpidit::amqp_large_content_test::Receiver receiver(argv[1], argv[2], argv[3], std::strtoul(argv[4], NULL, 0));
-        proton::container(receiver).run();
-
-        std::cout << argv[3] << std::endl;
-        Json::FastWriter fw;
-        std::cout << fw.write(receiver.getReceivedValueList());
+        qpidit::ShimArgs args(argc, argv);
+        if (args.hasOption("server")) {
+            // Arg 1 only; test jobs are read from stdin
+            qpidit::AmqpShimServer server("amqp_large_content_test::Receiver", args, qpidit::amqp_large_content_test::Receiver::createJob);
+            server.run();
+        } else {
+            if (args.numArgs() != 4) {
+                throw qpidit::ArgumentError("Incorrect number of arguments");
+            }
+            qpidit::amqp_large_content_test::Receiver receiver(args.arg(0), args.arg(1), args.arg(2), std::strtoul(args.arg(3).c_str(), NULL, 0));
+            receiver.setOptions(args);
+            receiver.run();
+            receiver.printResult(std::cout);
+        }
     } catch (const std::exception& e) {
         std::cerr << "amqp_large_content_test receiver error: " << e.what() << std::endl;
         exit(-1);
     }
     exit(0);
 }
+
+#endif /* QPIDIT_SHIM_NO_MAIN */
@@ -23,8 +23,14 @@
 #define SRC_QPIDIT_AMQP_LARGE_CONTENT_TEST_RECEIVER_HPP_
 
 #include <json/value.h>
+#include <proton/binary.hpp>
+#include <proton/codec/decoder.hpp>
+#include <proton/symbol.hpp>
 #include <proton/value.hpp>
 #include <qpidit/AmqpReceiverBase.hpp>
+#include <qpidit/Crc32c.hpp>
+#include <qpidit/PatternBuffer.hpp>
+#include <qpidit/amqp_large_content_test/Crc32cProperty.hpp>
 
 namespace qpidit
 {
@@ -38,16 +44,31 @@ namespace qpidit
             uint32_t _expected;
             uint32_t _received;
             Json::Value _receivedValueList;
+            qpidit::PatternBuffer _patternBuffer; // Reference test pattern
+            std::string _stringBuffer;  // Decode buffers, reused for each element
+            proton::symbol _symbolBuffer;
+            proton::binary _binaryBuffer;
+            qpidit::Crc32c _crc32c; // Of the content of the current message
+            bool _hasCrc32c; // Current message carries a content CRC32C, which is checked instead of the pattern
+            std::string _patternError; // First test pattern mismatch in the current message, empty if none
+            uint64_t _contentBytes; // Content size of the current message
+
+            static const uint32_t s_defaultCreditBytes; // Default --credit-bytes
         public:
             Receiver(const std::string& brokerAddr, const std::string& queueName, const std::string& amqpType, uint32_t exptected);
             virtual ~Receiver();
 
+            static qpidit::AmqpTestBase* createJob(const std::string& brokerAddr, const std::string& queueName, const std::string& amqpType, const std::string& expectedStr);
             Json::Value& getReceivedValueList();
-            void on_message(proton::delivery &d, proton::message &m);
+            void printResult(std::ostream& out);
         protected:
+            void processMessage(proton::delivery &d, proton::message &m);
             std::pair<uint32_t, uint32_t> getTestListSizeMb(const proton::value& testList);
             std::pair<uint32_t, uint32_t> getTestMapSizeMb(const proton::value& testMap);
             uint32_t getTestStringSizeMb(const proton::value& testString);
+            size_t checkNextTestString(proton::codec::decoder& dec, const std::string& context);
+            void checkContent(const char* data, size_t size, const std::string& context);
+            void checkCrc32c(const proton::message& msg);
             void appendListMapSize(Json::Value& numEltsList, std::pair<uint32_t, uint32_t> val);
             void createNewListMapSize(std::pair<uint32_t, uint32_t> val);
         };
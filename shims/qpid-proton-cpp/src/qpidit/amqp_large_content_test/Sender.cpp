@@ -24,12 +24,16 @@
 #include <iomanip>
 #include <iostream>
 #include <json/json.h>
+#include <proton/codec/encoder.hpp>
 #include <proton/container.hpp>
 #include <proton/connection.hpp>
 #include <proton/message.hpp>
 #include <proton/sender.hpp>
 #include <proton/tracker.hpp>
+#include <qpidit/AmqpShimServer.hpp>
+#include <qpidit/Crc32c.hpp>
 #include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
@@ -40,133 +44,179 @@ namespace qpidit
                        const std::string& queueName,
                        const std::string& amqpType,
                        const Json::Value& testValues) :
-                        AmqpSenderBase("amqp_large_content_test::Sender", brokerAddr, queueName, testValues.size()),
+                        AmqpSenderBase("amqp_large_content_test::Sender", brokerAddr, queueName, countMessages(testValues)),
                         _amqpType(amqpType),
-                        _testValues(testValues)
+                        _testValues(testValues),
+                        _testValuesItr(_testValues.begin()),
+                        _numElementsIndex(0),
+                        _stringContent(),
+                        _symbolContent(),
+                        _binaryContent(),
+                        _body(),
+                        _bodySizeBytes(0),
+                        _bodyNumElements(0),
+                        _bodyCrc32c(0)
         {}
 
         Sender::~Sender() {}
 
-        void Sender::on_sendable(proton::sender &s) {
-            if (_totalMsgs == 0) {
-                s.connection().close();
-            } else if (_msgsSent == 0) {
-                for (Json::Value::const_iterator i=_testValues.begin(); i!=_testValues.end(); ++i) {
-                    if (s.credit()) {
-                        uint32_t totSizeMb;
-                        Json::Value numElementsList = Json::arrayValue;
-                        if ((*i).isInt()) {
-                            totSizeMb = (*i).asInt();
-                            numElementsList.append(1);
-                        } else if ((*i).isArray()) {
-                            totSizeMb = (*i)[0].asInt();
-                            numElementsList = (*i)[1];
-                        } else {
-                            std::cerr << "on_sendable: Unexpected JSON type: " << (*i).type() << std::endl;
-                        }
-                        for (Json::Value::iterator numElementsAsStrItr=numElementsList.begin();
-                                                   numElementsAsStrItr!=numElementsList.end();
-                                                   ++numElementsAsStrItr) {
-                            proton::message msg;
-                            setMessage(msg, totSizeMb * 1024 * 1024, (*numElementsAsStrItr).asInt());
-                            s.send(msg);
-                            _msgsSent++;
-                        }
-                    }
-                }
-            } else {
-                // do nothing
+        //static
+        qpidit::AmqpTestBase* Sender::createJob(const std::string& brokerAddr,
+                                                const std::string& queueName,
+                                                const std::string& amqpType,
+                                                const std::string& testValuesStr) {
+            Json::Value testValues;
+            Json::Reader jsonReader;
+            if (not jsonReader.parse(testValuesStr, testValues, false)) {
+                throw qpidit::JsonParserError(jsonReader);
             }
+            return new Sender(brokerAddr, queueName, amqpType, testValues);
         }
 
         // protected
 
+        proton::message& Sender::setNextMessage(proton::message& msg) {
+            // Skip past test values with no (more) messages to send
+            while (_numElementsIndex >= numMessages(*_testValuesItr)) {
+                ++_testValuesItr;
+                _numElementsIndex = 0;
+            }
+            const Json::Value& testValue = *_testValuesItr;
+            if (testValue.isArray()) {
+                setMessage(msg, testValue[0].asInt() * 1024 * 1024, testValue[1][_numElementsIndex].asInt());
+            } else {
+                setMessage(msg, testValue.asInt() * 1024 * 1024, 1);
+            }
+            ++_numElementsIndex;
+            return msg;
+        }
+
         proton::message& Sender::setMessage(proton::message& msg,
                                             uint32_t totSizeBytes,
                                             uint32_t numElements) {
+            if (_body.empty() || totSizeBytes != _bodySizeBytes || numElements != _bodyNumElements) {
+                createBody(totSizeBytes, numElements);
+            }
+            msg.body(_body);
+            msg.properties().put(s_crc32cPropertyName, _bodyCrc32c);
+            return msg;
+        }
+
+        void Sender::createBody(uint32_t totSizeBytes, uint32_t numElements) {
+            _body.clear();
             if (_amqpType.compare("binary") == 0) {
-                proton::binary val(createTestString(totSizeBytes));
-                msg.body(val);
+                const proton::binary& content = setTestContent(_binaryContent, totSizeBytes);
+                _body = content;
+                _bodyCrc32c = content.empty() ? 0 : qpidit::Crc32c::compute(reinterpret_cast<const char*>(&content[0]), content.size());
             } else if (_amqpType.compare("string") == 0) {
-                msg.body(createTestString(totSizeBytes));
+                const std::string& content = setTestContent(_stringContent, totSizeBytes);
+                _body = content;
+                _bodyCrc32c = qpidit::Crc32c::compute(content.data(), content.size());
             } else if (_amqpType.compare("symbol") == 0) {
-                proton::symbol val(createTestString(totSizeBytes));
-                msg.body(val);
+                const proton::symbol& content = setTestContent(_symbolContent, totSizeBytes);
+                _body = content;
+                _bodyCrc32c = qpidit::Crc32c::compute(content.data(), content.size());
             } else if (_amqpType.compare("list") == 0) {
-                std::vector<proton::value> testList;
-                createTestList(testList, totSizeBytes, numElements);
-                msg.body(testList);
+                createTestList(totSizeBytes, numElements);
             } else if (_amqpType.compare("map") == 0) {
-                std::map<std::string, proton::value> testMap;
-                createTestMap(testMap, totSizeBytes, numElements);
-                msg.body(testMap);
+                createTestMap(totSizeBytes, numElements);
             }
-           return msg;
+            _bodySizeBytes = totSizeBytes;
+            _bodyNumElements = numElements;
         }
 
-        // static
-        void Sender::createTestList(std::vector<proton::value>& testList,
-                                    uint32_t totSizeBytes,
-                                    uint32_t numElements) {
-
-            uint32_t sizePerEltBytes = totSizeBytes / numElements;
+        void Sender::createTestList(uint32_t totSizeBytes, uint32_t numElements) {
+            // Encode directly into the body, all elements are the same string
+            const std::string& elt = setTestContent(_stringContent, totSizeBytes / numElements);
+            qpidit::Crc32c crc32c;
+            proton::codec::encoder enc(_body);
+            enc << proton::codec::start::list();
             for (uint32_t i=0; i<numElements; ++i) {
-                testList.push_back(createTestString(sizePerEltBytes));
+                enc << elt;
+                crc32c.update(elt.data(), elt.size());
             }
+            _bodyCrc32c = crc32c.value();
+            enc << proton::codec::finish();
         }
 
-        // static
-        void Sender::createTestMap(std::map<std::string, proton::value>& testMap,
-                                   uint32_t totSizeBytes,
-                                   uint32_t numElements) {
-
-            uint32_t sizePerEltBytes = totSizeBytes / numElements;
+        void Sender::createTestMap(uint32_t totSizeBytes, uint32_t numElements) {
+            // Encode directly into the body, keys are in sorted order as they would be in a std::map
+            const std::string& elt = setTestContent(_stringContent, totSizeBytes / numElements);
+            qpidit::Crc32c crc32c; // Of the values only
+            proton::codec::encoder enc(_body);
+            enc << proton::codec::start::map();
             for (uint32_t i=0; i<numElements; ++i) {
                 std::ostringstream oss;
                 oss << "elt_" << std::setw(6) << std::setfill('0') << i;
-                testMap[oss.str()] = createTestString(sizePerEltBytes);
+                enc << oss.str() << elt;
+                crc32c.update(elt.data(), elt.size());
             }
+            _bodyCrc32c = crc32c.value();
+            enc << proton::codec::finish();
         }
 
         //static
-        std::string Sender::createTestString(uint32_t msgSizeBytes) {
-            std::ostringstream oss;
-            for (uint32_t i=0; i<msgSizeBytes; ++i) {
-                oss << char('a' + (i%26));
+        uint32_t Sender::countMessages(const Json::Value& testValues) {
+            uint32_t count = 0;
+            for (Json::Value::const_iterator i=testValues.begin(); i!=testValues.end(); ++i) {
+                count += numMessages(*i);
             }
-            return oss.str();
+            return count;
+        }
+
+        //static
+        uint32_t Sender::numMessages(const Json::Value& testValue) {
+            // Test value is either total size in MB (a single message), or [total size in MB, [num elements, ...]]
+            // (one message per number of elements)
+            if (testValue.isInt()) {
+                return 1;
+            }
+            if (testValue.isArray()) {
+                return testValue[1].size();
+            }
+            throw qpidit::InvalidJsonRootNodeError(Json::arrayValue, testValue.type());
         }
 
    } /* namespace amqp_large_content_test */
 } /* namespace qpidit */
 
 
+#ifndef QPIDIT_SHIM_NO_MAIN // Defined when linked into another program, eg amqp_loopback_bench
+
 /*
  * --- main ---
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: AMQP type
- *       4: Test value(s) as JSON string
+ *       4: Test value(s) as JSON string, "-" to read it from stdin or "@file" to read it from a file
+ * Options: --server: Run as a persistent shim server (see AmqpShimServer); only arg 1 is used
+ *          --timestamp: Annotate each message with its send time (for receiver --latency)
  */
 
 int main(int argc, char** argv) {
-    // TODO: improve arg management a little...
-    if (argc != 5) {
-        throw qpidit::ArgumentError("Incorrect number of arguments");
-    }
-
     try {
-        Json::Value testValues;
-        Json::Reader jsonReader;
-        if (not jsonReader.parse(argv[4], testValues, false)) {
-            throw qpidit::JsonParserError(jsonReader);
-        }
+        qpidit::ShimArgs args(argc, argv);
+        if (args.hasOption("server")) {
+            // Arg 1 only; test jobs are read from stdin
+            qpidit::AmqpShimServer server("amqp_large_content_test::Sender", args, qpidit::amqp_large_content_test::Sender::createJob);
+            server.run();
+        } else {
+            if (args.numArgs() != 4) {
+                throw qpidit::ArgumentError("Incorrect number of arguments");
+            }
+            Json::Value testValues;
+            args.jsonArg(3, testValues);
 
-        qpidit::amqp_large_content_test::Sender sender(argv[1], argv[2], argv[3], testValues);
-        proton::container(sender).run();
+            qpidit::amqp_large_content_test::Sender sender(args.arg(0), args.arg(1), args.arg(2), testValues);
+            sender.setOptions(args);
+            sender.run();
+            sender.printResult(std::cout);
+        }
     } catch (const std::exception& e) {
         std::cerr << "amqp_large_content_test Sender error: " << e.what() << std::endl;
         exit(1);
     }
     exit(0);
 }
+
+#endif /* QPIDIT_SHIM_NO_MAIN */
@@ -23,8 +23,12 @@
 #define SRC_QPIDIT_AMQP_LARGE_CONTENT_TEST_SENDER_HPP_
 
 #include <json/value.h>
+#include <proton/binary.hpp>
+#include <proton/symbol.hpp>
 #include <proton/value.hpp>
 #include <qpidit/AmqpSenderBase.hpp>
+#include <qpidit/PatternBuffer.hpp>
+#include <qpidit/amqp_large_content_test/Crc32cProperty.hpp>
 
 namespace qpidit
 {
@@ -36,6 +40,17 @@ namespace qpidit
         protected:
             const std::string _amqpType;
             const Json::Value _testValues;
+            Json::Value::const_iterator _testValuesItr; // Test value of next message to send
+            uint32_t _numElementsIndex; // Index into the number-of-elements list of the current test value
+            // Test pattern content, filled in place by setTestContent() so that it reaches proton without an
+            // intermediate copy: of string bodies and list or map elements, of symbol bodies and of binary bodies
+            std::string _stringContent;
+            proton::symbol _symbolContent;
+            proton::binary _binaryContent;
+            proton::value _body; // Body of the last message sent, reused while the size and num elements are unchanged
+            uint32_t _bodySizeBytes;
+            uint32_t _bodyNumElements;
+            uint32_t _bodyCrc32c; // CRC32C of the body content, sent in the s_crc32cPropertyName property
 
         public:
             Sender(const std::string& brokerAddr,
@@ -44,19 +59,29 @@ namespace qpidit
                    const Json::Value& testValues);
             virtual ~Sender();
 
-            void on_sendable(proton::sender &s);
-
+            static qpidit::AmqpTestBase* createJob(const std::string& brokerAddr,
+                                                   const std::string& queueName,
+                                                   const std::string& amqpType,
+                                                   const std::string& testValuesStr);
         protected:
+            proton::message& setNextMessage(proton::message& msg);
             proton::message& setMessage(proton::message& msg,
                                         uint32_t totSizeBytes,
                                         uint32_t numElements);
-            static void createTestList(std::vector<proton::value>& testList,
-                                       uint32_t totSizeBytes,
-                                       uint32_t numElements);
-            static void createTestMap(std::map<std::string, proton::value>& testMap,
-                                      uint32_t totSizeBytes,
-                                      uint32_t numElements);
-            static std::string createTestString(uint32_t msgSizeBytes);
+            void createBody(uint32_t totSizeBytes, uint32_t numElements);
+            void createTestList(uint32_t totSizeBytes, uint32_t numElements);
+            void createTestMap(uint32_t totSizeBytes, uint32_t numElements);
+            static uint32_t countMessages(const Json::Value& testValues);
+            static uint32_t numMessages(const Json::Value& testValue);
+
+            // Make content size bytes of the test pattern, reusing it if it is already that size
+            template<typename T> static const T& setTestContent(T& content, uint32_t size) {
+                if (content.size() != size) {
+                    content.resize(size);
+                    if (size > 0) qpidit::PatternBuffer::fill(reinterpret_cast<char*>(&content[0]), size);
+                }
+                return content;
+            }
         };
 
     } /* namespace amqp_large_content_test */
@@ -0,0 +1,204 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/amqp_local_broker/Broker.hpp"
+
+#include <iostream>
+#include <proton/connection.hpp>
+#include <proton/container.hpp>
+#include <proton/delivery.hpp>
+#include <proton/delivery_mode.hpp>
+#include <proton/error_condition.hpp>
+#include <proton/message.hpp>
+#include <proton/receiver_options.hpp>
+#include <proton/sender_options.hpp>
+#include <proton/source.hpp>
+#include <proton/source_options.hpp>
+#include <proton/target.hpp>
+#include <proton/target_options.hpp>
+#include <proton/transport.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
+#include <qpidit/amqp_local_broker/Queue.hpp>
+#include <sstream>
+#include <stdlib.h> // exit()
+
+namespace qpidit
+{
+    namespace amqp_local_broker
+    {
+
+        Broker::Broker(const std::string& listenAddr, const ShimArgs& args) :
+                        _listenAddr(listenAddr),
+                        _queueDepth(args.getUintOption("queue-depth", 10000)),
+                        _creditWindow(args.getUintOption("credit-window", 1000)),
+                        _queues(),
+                        _consumerQueues(),
+                        _producerQueues(),
+                        _dynamicQueueCount(0)
+        {
+            if (_queueDepth == 0 || _creditWindow == 0) {
+                throw qpidit::ArgumentError("Options --queue-depth and --credit-window must be at least 1");
+            }
+        }
+
+        Broker::~Broker() {
+            for (queueMap_t::iterator i = _queues.begin(); i != _queues.end(); ++i) {
+                delete i->second;
+            }
+        }
+
+        void Broker::run() {
+            proton::container(*this).run();
+        }
+
+        void Broker::on_container_start(proton::container& c) {
+            c.listen(_listenAddr);
+            // The test harness waits for this line before starting any shims
+            std::cout << "Listening on " << _listenAddr << std::endl;
+        }
+
+        void Broker::on_sender_open(proton::sender& s) {
+            std::string address = s.source().address();
+            if (s.source().dynamic()) {
+                std::ostringstream oss;
+                oss << "qpidit-dynamic-" << ++_dynamicQueueCount;
+                address = oss.str();
+            }
+            Queue& q = getQueue(address);
+            s.open(proton::sender_options().source(proton::source_options().address(address))
+                                           .delivery_mode(proton::delivery_mode::AT_MOST_ONCE));
+            _consumerQueues[s] = &q;
+            q.addConsumer(s);
+        }
+
+        void Broker::on_sender_close(proton::sender& s) {
+            std::map<proton::sender, Queue*>::iterator i = _consumerQueues.find(s);
+            if (i == _consumerQueues.end()) return;
+            i->second->removeConsumer(s);
+            _consumerQueues.erase(i);
+        }
+
+        void Broker::on_sendable(proton::sender& s) {
+            std::map<proton::sender, Queue*>::iterator i = _consumerQueues.find(s);
+            if (i != _consumerQueues.end()) i->second->dispatch();
+        }
+
+        void Broker::on_receiver_open(proton::receiver& r) {
+            const std::string address = r.target().address();
+            Queue& q = getQueue(address);
+            // Credit is issued by the queue, for its free space only
+            r.open(proton::receiver_options().target(proton::target_options().address(address)).credit_window(0));
+            _producerQueues[r] = &q;
+            q.addProducer(r);
+        }
+
+        void Broker::on_receiver_close(proton::receiver& r) {
+            std::map<proton::receiver, Queue*>::iterator i = _producerQueues.find(r);
+            if (i == _producerQueues.end()) return;
+            Queue* q = i->second;
+            _producerQueues.erase(i);
+            q->removeProducer(r);
+        }
+
+        void Broker::on_message(proton::delivery& d, proton::message& m) {
+            std::map<proton::receiver, Queue*>::iterator i = _producerQueues.find(d.receiver());
+            if (i == _producerQueues.end()) {
+                d.reject();
+                return;
+            }
+            if (!i->second->push(m)) {
+                d.release(); // Only possible if the producer ignores its credit
+                return;
+            }
+            i->second->dispatch();
+        }
+
+        void Broker::on_transport_close(proton::transport& t) {
+            // Links are not closed when a client disconnects abruptly, so remove them here
+            removeLinks(t.connection());
+        }
+
+        void Broker::on_transport_error(proton::transport& t) {
+            std::cerr << "amqp_local_broker::on_transport_error: " << t.error() << std::endl;
+        }
+
+        void Broker::on_error(const proton::error_condition& ec) {
+            std::cerr << "amqp_local_broker::on_error: " << ec << std::endl;
+        }
+
+        // protected
+
+        Queue& Broker::getQueue(const std::string& name) {
+            queueMap_t::iterator i = _queues.find(name);
+            if (i == _queues.end()) {
+                i = _queues.insert(queueMap_t::value_type(name, new Queue(name, _queueDepth, _creditWindow))).first;
+            }
+            return *i->second;
+        }
+
+        void Broker::removeLinks(const proton::connection& c) {
+            for (std::map<proton::sender, Queue*>::iterator i = _consumerQueues.begin(); i != _consumerQueues.end(); ) {
+                if (i->first.connection() == c) {
+                    i->second->removeConsumer(i->first);
+                    _consumerQueues.erase(i++);
+                } else {
+                    ++i;
+                }
+            }
+            for (std::map<proton::receiver, Queue*>::iterator i = _producerQueues.begin(); i != _producerQueues.end(); ) {
+                if (i->first.connection() == c) {
+                    Queue* q = i->second;
+                    const proton::receiver r = i->first;
+                    _producerQueues.erase(i++);
+                    q->removeProducer(r);
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+    } /* namespace amqp_local_broker */
+} /* namespace qpidit */
+
+
+/*
+ * --- main ---
+ * Args: 1: Listen address (ip-addr:port)
+ * Options: --queue-depth=N: Capacity of each queue in messages (default 10000)
+ *          --credit-window=N: Most credit outstanding on each producer link (default 1000)
+ * Output: "Listening on <address>" once the broker is ready for connections
+ */
+
+int main(int argc, char** argv) {
+    try {
+        qpidit::ShimArgs args(argc, argv);
+        if (args.numArgs() != 1) {
+            throw qpidit::ArgumentError("Incorrect number of arguments");
+        }
+        qpidit::amqp_local_broker::Broker broker(args.arg(0), args);
+        broker.run();
+    } catch (const std::exception& e) {
+        std::cerr << "amqp_local_broker error: " << e.what() << std::endl;
+        exit(1);
+    }
+    exit(0);
+}
@@ -0,0 +1,82 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQP_LOCAL_BROKER_BROKER_HPP_
+#define SRC_QPIDIT_AMQP_LOCAL_BROKER_BROKER_HPP_
+
+#include <map>
+#include <proton/messaging_handler.hpp>
+#include <proton/receiver.hpp>
+#include <proton/sender.hpp>
+#include <stdint.h>
+#include <string>
+
+namespace qpidit
+{
+    class ShimArgs;
+
+    namespace amqp_local_broker
+    {
+        class Queue;
+
+        /*
+         * Minimal stand-in for an external broker, so that pairs of shims can be tested and benchmarked without
+         * installing one. Queues are created on first use by either a producer or a consumer link, and are
+         * held in memory only. Received messages are accepted once queued, and forwarded pre-settled.
+         * The broker runs on a single thread, and runs until it is killed.
+         */
+        class Broker : public proton::messaging_handler
+        {
+        protected:
+            typedef std::map<std::string, Queue*> queueMap_t;
+
+            const std::string _listenAddr;
+            const size_t _queueDepth;
+            const uint32_t _creditWindow;
+            queueMap_t _queues;
+            std::map<proton::sender, Queue*> _consumerQueues;
+            std::map<proton::receiver, Queue*> _producerQueues;
+            uint64_t _dynamicQueueCount;
+        public:
+            Broker(const std::string& listenAddr, const ShimArgs& args);
+            virtual ~Broker();
+
+            void run();
+
+            void on_container_start(proton::container& c);
+            void on_sender_open(proton::sender& s);
+            void on_sender_close(proton::sender& s);
+            void on_sendable(proton::sender& s);
+            void on_receiver_open(proton::receiver& r);
+            void on_receiver_close(proton::receiver& r);
+            void on_message(proton::delivery& d, proton::message& m);
+            void on_transport_close(proton::transport& t);
+            void on_transport_error(proton::transport& t);
+            void on_error(const proton::error_condition& ec);
+        protected:
+            Queue& getQueue(const std::string& name);
+            void removeLinks(const proton::connection& c);
+        };
+
+    } /* namespace amqp_local_broker */
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQP_LOCAL_BROKER_BROKER_HPP_ */
@@ -0,0 +1,120 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/amqp_local_broker/Queue.hpp"
+
+#include <algorithm>
+
+namespace qpidit
+{
+    namespace amqp_local_broker
+    {
+
+        Queue::Queue(const std::string& name, size_t capacity, uint32_t creditWindow) :
+                        _name(name),
+                        _creditWindow(creditWindow),
+                        _ring(capacity),
+                        _head(0),
+                        _count(0),
+                        _consumers(),
+                        _nextConsumer(0),
+                        _producers()
+        {}
+
+        Queue::~Queue() {}
+
+        const std::string& Queue::name() const {
+            return _name;
+        }
+
+        bool Queue::push(proton::message& m) {
+            if (_count == _ring.size()) return false;
+            // Swap rather than copy: the message is not encoded again until it is sent on
+            using std::swap;
+            swap(_ring[(_head + _count) % _ring.size()], m);
+            ++_count;
+            return true;
+        }
+
+        void Queue::addConsumer(const proton::sender& s) {
+            _consumers.push_back(s);
+        }
+
+        void Queue::removeConsumer(const proton::sender& s) {
+            std::vector<proton::sender>::iterator i = std::find(_consumers.begin(), _consumers.end(), s);
+            if (i == _consumers.end()) return;
+            _consumers.erase(i);
+            if (_nextConsumer >= _consumers.size()) _nextConsumer = 0;
+        }
+
+        void Queue::addProducer(const proton::receiver& r) {
+            _producers.push_back(r);
+            grantCredit();
+        }
+
+        void Queue::removeProducer(const proton::receiver& r) {
+            std::vector<proton::receiver>::iterator i = std::find(_producers.begin(), _producers.end(), r);
+            if (i != _producers.end()) _producers.erase(i);
+            grantCredit(); // Credit held by the closed link may now go to the others
+        }
+
+        void Queue::dispatch() {
+            bool sent = true;
+            while (_count > 0 && sent) {
+                // One pass over the consumers; stop once none of them has credit
+                sent = false;
+                for (size_t n = 0; n < _consumers.size() && _count > 0; ++n) {
+                    proton::sender& s = _consumers[_nextConsumer];
+                    _nextConsumer = (_nextConsumer + 1) % _consumers.size();
+                    if (s.credit() > 0) {
+                        s.send(_ring[_head]);
+                        _ring[_head] = proton::message(); // Don't hold on to sent content until the slot is reused
+                        _head = (_head + 1) % _ring.size();
+                        --_count;
+                        sent = true;
+                    }
+                }
+            }
+            grantCredit();
+        }
+
+        // protected
+
+        void Queue::grantCredit() {
+            size_t outstanding = 0;
+            for (std::vector<proton::receiver>::const_iterator i = _producers.begin(); i != _producers.end(); ++i) {
+                outstanding += std::max(i->credit(), 0);
+            }
+            const size_t space = _ring.size() - _count;
+            if (outstanding >= space) return;
+            size_t available = space - outstanding;
+            for (std::vector<proton::receiver>::iterator i = _producers.begin(); i != _producers.end() && available > 0; ++i) {
+                const uint32_t credit = std::max(i->credit(), 0);
+                // Top up in batches of at least half a window, rather than sending a flow frame per message
+                if (credit > _creditWindow / 2) continue;
+                const uint32_t topUp = std::min(size_t(_creditWindow - credit), available);
+                i->add_credit(topUp);
+                available -= topUp;
+            }
+        }
+
+    } /* namespace amqp_local_broker */
+} /* namespace qpidit */
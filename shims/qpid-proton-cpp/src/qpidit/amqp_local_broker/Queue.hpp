@@ -0,0 +1,74 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQP_LOCAL_BROKER_QUEUE_HPP_
+#define SRC_QPIDIT_AMQP_LOCAL_BROKER_QUEUE_HPP_
+
+#include <proton/message.hpp>
+#include <proton/receiver.hpp>
+#include <proton/sender.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace qpidit
+{
+    namespace amqp_local_broker
+    {
+
+        /*
+         * A local broker queue. Messages are held in a fixed-capacity ring, so that a queue never grows or
+         * allocates once it is in use. Producer links are only granted credit for free ring slots, so a full
+         * queue holds back its producers rather than rejecting their messages. Messages are forwarded to the
+         * consumer links round-robin, while they have credit.
+         */
+        class Queue
+        {
+        protected:
+            const std::string _name;
+            const uint32_t _creditWindow; // Most credit outstanding on one producer link
+            std::vector<proton::message> _ring;
+            size_t _head; // Index of the oldest message in _ring
+            size_t _count;
+            std::vector<proton::sender> _consumers;
+            size_t _nextConsumer; // Round-robin index into _consumers
+            std::vector<proton::receiver> _producers;
+        public:
+            Queue(const std::string& name, size_t capacity, uint32_t creditWindow);
+            virtual ~Queue();
+
+            const std::string& name() const;
+            // Moves the content of m into the queue, leaving m empty; false if the queue is full
+            bool push(proton::message& m);
+            void addConsumer(const proton::sender& s);
+            void removeConsumer(const proton::sender& s);
+            void addProducer(const proton::receiver& r);
+            void removeProducer(const proton::receiver& r);
+            // Forwards as many messages as the consumers have credit for, then tops up the producers' credit
+            void dispatch();
+        protected:
+            void grantCredit();
+        };
+
+    } /* namespace amqp_local_broker */
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQP_LOCAL_BROKER_QUEUE_HPP_ */
@@ -0,0 +1,159 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/amqp_loopback_bench/LoopbackBench.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <proton/connection.hpp>
+#include <proton/connection_options.hpp>
+#include <proton/io/connection_driver.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/amqp_large_content_test/Receiver.hpp>
+#include <qpidit/amqp_large_content_test/Sender.hpp>
+#include <qpidit/amqp_types_test/Receiver.hpp>
+#include <qpidit/amqp_types_test/Sender.hpp>
+#include <stdlib.h> // exit()
+
+namespace qpidit
+{
+    namespace amqp_loopback_bench
+    {
+
+        //static
+        const std::string LoopbackBench::s_address("loopback");
+
+        LoopbackBench::LoopbackBench(const ShimArgs& args) :
+                        BenchBase(args, 1),
+                        _args(args),
+                        _largeContentFlag(args.hasOption("large-content"))
+        {
+            // The drivers are run from this thread only, and there is no container to run timers or a server loop
+            if (args.hasOption("threads") || args.hasOption("ack-interval") || args.hasOption("server")) {
+                throw qpidit::ArgumentError("--threads, --ack-interval and --server cannot be used with a loopback connection");
+            }
+        }
+
+        LoopbackBench::~LoopbackBench() {}
+
+        // protected
+
+        Json::Value LoopbackBench::runType(const std::string& amqpType, const Json::Value& testValues) {
+            if (_largeContentFlag) {
+                return runShims<amqp_large_content_test::Sender, amqp_large_content_test::Receiver>(amqpType, repeatValues(testValues));
+            }
+            return runShims<amqp_types_test::Sender, amqp_types_test::Receiver>(amqpType, repeatValues(testValues));
+        }
+
+        template<class S, class R> Json::Value LoopbackBench::runShims(const std::string& amqpType, const Json::Value& testValues) {
+            S sender(s_address, s_address, amqpType, testValues);
+            sender.setOptions(_args);
+            R receiver(s_address, s_address, amqpType, sender.totalMsgs());
+            receiver.setOptions(_args);
+
+            proton::io::connection_driver client;
+            proton::io::connection_driver server;
+            const int64_t startNs = nowNs();
+            server.accept(proton::connection_options().handler(receiver));
+            client.connect(proton::connection_options().handler(sender));
+            proton::connection c = client.connection();
+            sender.openLink(c);
+            runDrivers(client, server);
+            const int64_t elapsedNs = nowNs() - startNs;
+
+            if (receiver.msgsReceived() < sender.totalMsgs()) {
+                throw qpidit::LoopbackStalledError(amqpType, sender.totalMsgs(), receiver.msgsReceived());
+            }
+            const uint32_t numMsgs = receiver.msgsReceived();
+            const double elapsedSecs = double(elapsedNs) / 1e9;
+            Json::Value result(Json::objectValue);
+            result["type"] = amqpType;
+            result["messages"] = numMsgs;
+            result["seconds"] = elapsedSecs;
+            result["msgs_per_sec"] = elapsedSecs > 0.0 ? numMsgs / elapsedSecs : 0.0;
+            result["ns_per_msg"] = numMsgs > 0 ? double(elapsedNs) / numMsgs : 0.0;
+            return result;
+        }
+
+        Json::Value LoopbackBench::repeatValues(const Json::Value& testValues) const {
+            Json::Value repeated(Json::arrayValue);
+            for (uint32_t r = 0; r < _repeat; ++r) {
+                for (Json::Value::const_iterator i = testValues.begin(); i != testValues.end(); ++i) {
+                    repeated.append(*i);
+                }
+            }
+            return repeated;
+        }
+
+        //static
+        void LoopbackBench::runDrivers(proton::io::connection_driver& client, proton::io::connection_driver& server) {
+            bool clientActive = true;
+            bool serverActive = true;
+            while (clientActive || serverActive) {
+                clientActive = client.dispatch();
+                serverActive = server.dispatch();
+                if (transfer(client, server) + transfer(server, client) > 0) continue;
+                if (clientActive && serverActive) {
+                    return; // Neither side has anything to send, but neither has finished: stalled
+                }
+                // One side has closed its end; there are no sockets to report end of stream to the other
+                if (clientActive) {
+                    client.read_close();
+                    client.write_close();
+                }
+                if (serverActive) {
+                    server.read_close();
+                    server.write_close();
+                }
+            }
+        }
+
+        //static
+        size_t LoopbackBench::transfer(proton::io::connection_driver& from, proton::io::connection_driver& to) {
+            const proton::io::const_buffer wbuf = from.write_buffer();
+            if (wbuf.size == 0) return 0;
+            const proton::io::mutable_buffer rbuf = to.read_buffer();
+            const size_t n = std::min(wbuf.size, rbuf.size);
+            if (n == 0) return 0;
+            std::memcpy(rbuf.data, wbuf.data, n);
+            to.read_done(n);
+            from.write_done(n);
+            return n;
+        }
+
+    } /* namespace amqp_loopback_bench */
+} /* namespace qpidit */
+
+
+/*
+ * --- main ---
+ * Args: 1: Test values as a JSON map of AMQP type to a list of values (in the form used by the amqp_types_test
+ *          Sender, or by the amqp_large_content_test Sender with --large-content), "-" to read it from stdin or
+ *          "@file" to read it from a file
+ * Options: --repeat=N: Send each list of test values N times (default 1)
+ *          --large-content: Use the amqp_large_content_test Sender and Receiver
+ *          Other Sender and Receiver options (eg --presettled, --ack-batch) are passed to both
+ * Output: One JSON map per AMQP type containing the message count, time, messages/s and ns/message
+ */
+
+int main(int argc, char** argv) {
+    exit(qpidit::BenchBase::main<qpidit::amqp_loopback_bench::LoopbackBench>(argc, argv, "amqp_loopback_bench"));
+}
@@ -0,0 +1,61 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQP_LOOPBACK_BENCH_LOOPBACKBENCH_HPP_
+#define SRC_QPIDIT_AMQP_LOOPBACK_BENCH_LOOPBACKBENCH_HPP_
+
+#include <qpidit/BenchBase.hpp>
+
+namespace proton { namespace io { class connection_driver; } }
+
+namespace qpidit
+{
+    namespace amqp_loopback_bench
+    {
+
+        /*
+         * Runs a shim Sender and Receiver in one process, each handled by a proton::io::connection_driver, with
+         * the bytes written by each driver copied directly into the other's read buffer. There is no broker and
+         * no socket, so the result is the cost of the shim encode/decode paths and the proton protocol engine.
+         */
+        class LoopbackBench : public BenchBase
+        {
+        protected:
+            static const std::string s_address;
+
+            const ShimArgs& _args;
+            const bool _largeContentFlag; // Use the amqp_large_content_test shims rather than amqp_types_test
+        public:
+            LoopbackBench(const ShimArgs& args);
+            virtual ~LoopbackBench();
+        protected:
+            Json::Value runType(const std::string& amqpType, const Json::Value& testValues);
+            template<class S, class R> Json::Value runShims(const std::string& amqpType, const Json::Value& testValues);
+            Json::Value repeatValues(const Json::Value& testValues) const;
+
+            static void runDrivers(proton::io::connection_driver& client, proton::io::connection_driver& server);
+            static size_t transfer(proton::io::connection_driver& from, proton::io::connection_driver& to);
+        };
+
+    } /* namespace amqp_loopback_bench */
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQP_LOOPBACK_BENCH_LOOPBACKBENCH_HPP_ */
@@ -0,0 +1,152 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/amqp_perf_test/Receiver.hpp"
+
+#include <iostream>
+#include <json/json.h>
+#include <stdlib.h> // exit()
+#include <proton/codec/decoder.hpp>
+#include <proton/container.hpp>
+#include <proton/delivery.hpp>
+#include <proton/message.hpp>
+#include <proton/receiver.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
+
+namespace qpidit
+{
+    namespace amqp_perf_test
+    {
+
+        Receiver::Receiver(const std::string& brokerAddr,
+                           const std::string& queueName,
+                           const std::string& amqpType,
+                           uint32_t expected) :
+                        AmqpReceiverBase("amqp_perf_test::Receiver", brokerAddr, queueName),
+                        _amqpType(amqpType),
+                        _expected(expected),
+                        _received(0UL),
+                        _totalBytes(0ULL),
+                        _firstSendNs(0LL),
+                        _firstReceiveNs(0LL),
+                        _lastReceiveNs(0LL),
+                        _stringBuffer(),
+                        _binaryBuffer()
+        {
+            _latencyFlag = true;
+        }
+
+        Receiver::~Receiver() {}
+
+        void Receiver::printResult(std::ostream& out) {
+            const int64_t startNs = _firstSendNs > 0 ? _firstSendNs : _firstReceiveNs;
+            const double elapsedSecs = double(_lastReceiveNs - startNs) / 1e9;
+            Json::Value result(Json::objectValue);
+            result["messages"] = _received;
+            result["bytes"] = Json::UInt64(_totalBytes);
+            result["seconds"] = elapsedSecs;
+            result["msgs_per_sec"] = elapsedSecs > 0.0 ? _received / elapsedSecs : 0.0;
+            result["mb_per_sec"] = elapsedSecs > 0.0 ? _totalBytes / elapsedSecs / 1024 / 1024 : 0.0;
+            if (_latencyHistogram.count() > 0) {
+                result["latency_us"] = _latencyHistogram.toJson();
+            }
+            out << _amqpType << std::endl;
+            Json::FastWriter fw;
+            out << fw.write(result);
+        }
+
+        // protected
+
+        void Receiver::processMessage(proton::delivery &d, proton::message &m) {
+            try {
+                if (_received < _expected) {
+                    const int64_t receiveNs = nowNs();
+                    if (_received == 0) {
+                        _firstReceiveNs = receiveNs;
+                    }
+                    _lastReceiveNs = receiveNs;
+                    if (m.message_annotations().exists(s_sendTimeAnnotation)) {
+                        const int64_t sendNs = proton::get<int64_t>(m.message_annotations().get(s_sendTimeAnnotation));
+                        if (_firstSendNs == 0 || sendNs < _firstSendNs) {
+                            _firstSendNs = sendNs;
+                        }
+                    }
+                    const size_t bodySize = getBodySize(m);
+                    _totalBytes += bodySize;
+                    recordMessageSize(bodySize);
+                }
+                _received++;
+                if (_received >= _expected) {
+                    testComplete(d.receiver());
+                }
+            } catch (const std::exception&) {
+                d.receiver().close();
+                d.connection().close();
+                throw;
+            }
+        }
+
+        size_t Receiver::getBodySize(const proton::message& m) {
+            proton::codec::decoder dec(m.body());
+            const proton::type_id expectedType = _amqpType.compare("string") == 0 ? proton::STRING : proton::BINARY;
+            const proton::type_id type = dec.next_type();
+            if (type != expectedType) {
+                throw qpidit::IncorrectMessageBodyTypeError(expectedType, type);
+            }
+            if (type == proton::STRING) {
+                dec >> _stringBuffer;
+                return _stringBuffer.size();
+            }
+            dec >> _binaryBuffer;
+            return _binaryBuffer.size();
+        }
+
+    } /* namespace amqp_perf_test */
+} /* namespace qpidit */
+
+
+/*
+ * --- main ---
+ * Args: 1: Broker address (ip-addr:port)
+ *       2: Queue name
+ *       3: AMQP type (binary or string)
+ *       4: Expected number of messages to receive
+ * Options: See AmqpReceiverBase (eg --prefetch, --listen)
+ * Output: AMQP type, then a JSON map containing the throughput and latency percentiles (in us)
+ */
+
+int main(int argc, char** argv) {
+    try {
+        qpidit::ShimArgs args(argc, argv);
+        if (args.numArgs() != 4) {
+            throw qpidit::ArgumentError("Incorrect number of arguments");
+        }
+        qpidit::amqp_perf_test::Receiver receiver(args.arg(0), args.arg(1), args.arg(2), std::strtoul(args.arg(3).c_str(), NULL, 0));
+        receiver.setOptions(args);
+        receiver.run();
+        receiver.printResult(std::cout);
+    } catch (const std::exception& e) {
+        std::cerr << "amqp_perf_test Receiver error: " << e.what() << std::endl;
+        exit(-1);
+    }
+    exit(0);
+}
@@ -0,0 +1,59 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQP_PERF_TEST_RECEIVER_HPP_
+#define SRC_QPIDIT_AMQP_PERF_TEST_RECEIVER_HPP_
+
+#include <stdint.h>
+#include <proton/binary.hpp>
+#include <qpidit/AmqpReceiverBase.hpp>
+
+namespace qpidit
+{
+    namespace amqp_perf_test
+    {
+
+        class Receiver : public qpidit::AmqpReceiverBase
+        {
+        protected:
+            const std::string _amqpType;
+            uint32_t _expected;
+            uint32_t _received;
+            uint64_t _totalBytes;
+            int64_t _firstSendNs; // 0 if the sender does not timestamp its messages
+            int64_t _firstReceiveNs;
+            int64_t _lastReceiveNs;
+            std::string _stringBuffer; // Decode buffers, reused for each message
+            proton::binary _binaryBuffer;
+        public:
+            Receiver(const std::string& brokerAddr, const std::string& queueName, const std::string& amqpType, uint32_t expected);
+            virtual ~Receiver();
+
+            void printResult(std::ostream& out);
+        protected:
+            void processMessage(proton::delivery &d, proton::message &m);
+            size_t getBodySize(const proton::message& m);
+        };
+
+    } /* namespace amqp_perf_test */
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQP_PERF_TEST_RECEIVER_HPP_ */
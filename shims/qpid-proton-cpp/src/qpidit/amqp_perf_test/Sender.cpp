@@ -0,0 +1,107 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#include "qpidit/amqp_perf_test/Sender.hpp"
+
+#include <iostream>
+#include <json/json.h>
+#include <proton/binary.hpp>
+#include <proton/container.hpp>
+#include <proton/message.hpp>
+#include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
+
+namespace qpidit
+{
+    namespace amqp_perf_test
+    {
+
+        Sender::Sender(const std::string& brokerAddr,
+                       const std::string& queueName,
+                       const std::string& amqpType,
+                       const Json::Value& testParams) :
+                        AmqpSenderBase("amqp_perf_test::Sender", brokerAddr, queueName, getUintParam(testParams, "count", 10000)),
+                        _amqpType(amqpType),
+                        _msgSizeBytes(getUintParam(testParams, "size", 1024)),
+                        _patternBuffer(),
+                        _body()
+        {
+            _timestampFlag = true;
+            const char* data = _patternBuffer.data(_msgSizeBytes);
+            if (_amqpType.compare("binary") == 0) {
+                _body = proton::binary(data, data + _msgSizeBytes);
+            } else if (_amqpType.compare("string") == 0) {
+                _body = std::string(data, _msgSizeBytes);
+            } else {
+                throw qpidit::UnsupportedAmqpTypeError(_amqpType);
+            }
+        }
+
+        Sender::~Sender() {}
+
+        // protected
+
+        proton::message& Sender::setNextMessage(proton::message& msg) {
+            msg.id(_msgsSent + 1);
+            msg.body(_body);
+            return msg;
+        }
+
+        //static
+        uint32_t Sender::getUintParam(const Json::Value& testParams, const char* name, uint32_t defaultValue) {
+            if (!testParams.isObject()) {
+                throw qpidit::InvalidJsonRootNodeError(Json::objectValue, testParams.type());
+            }
+            return testParams.get(name, defaultValue).asUInt();
+        }
+
+    } /* namespace amqp_perf_test */
+} /* namespace qpidit */
+
+
+/*
+ * --- main ---
+ * Args: 1: Broker address (ip-addr:port)
+ *       2: Queue name
+ *       3: AMQP type (binary or string)
+ *       4: Test parameters as JSON map: {"count": <num messages>, "size": <body size in bytes>}
+ * Options: See AmqpSenderBase (eg --connections, --links, --max-in-flight)
+ */
+
+int main(int argc, char** argv) {
+    try {
+        qpidit::ShimArgs args(argc, argv);
+        if (args.numArgs() != 4) {
+            throw qpidit::ArgumentError("Incorrect number of arguments");
+        }
+        Json::Value testParams;
+        args.jsonArg(3, testParams);
+
+        qpidit::amqp_perf_test::Sender sender(args.arg(0), args.arg(1), args.arg(2), testParams);
+        sender.setOptions(args);
+        sender.run();
+        sender.printResult(std::cout);
+    } catch (const std::exception& e) {
+        std::cerr << "amqp_perf_test Sender error: " << e.what() << std::endl;
+        exit(1);
+    }
+    exit(0);
+}
@@ -0,0 +1,89 @@
+/*
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ */
+
+#ifndef SRC_QPIDIT_AMQP_TYPES_TEST_AMQPTYPES_HPP_
+#define SRC_QPIDIT_AMQP_TYPES_TEST_AMQPTYPES_HPP_
+
+#include <string>
+
+/*
+ * Single list of the AMQP types known to amqp_types_test, shared by Sender and Receiver.
+ * Each entry is X(Name, "amqp type name"). Sender implements encode<Name>(), Receiver
+ * implements decode<Name>(); adding a type means adding one line here plus those two methods.
+ */
+#define QPIDIT_AMQP_TYPES(X) \
+    X(Null,       "null") \
+    X(Boolean,    "boolean") \
+    X(Ubyte,      "ubyte") \
+    X(Ushort,     "ushort") \
+    X(Uint,       "uint") \
+    X(Ulong,      "ulong") \
+    X(Byte,       "byte") \
+    X(Short,      "short") \
+    X(Int,        "int") \
+    X(Long,       "long") \
+    X(Float,      "float") \
+    X(Double,     "double") \
+    X(Decimal32,  "decimal32") \
+    X(Decimal64,  "decimal64") \
+    X(Decimal128, "decimal128") \
+    X(Char,       "char") \
+    X(Timestamp,  "timestamp") \
+    X(Uuid,       "uuid") \
+    X(Binary,     "binary") \
+    X(String,     "string") \
+    X(Symbol,     "symbol") \
+    X(List,       "list") \
+    X(Map,        "map") \
+    X(Array,      "array")
+
+namespace qpidit
+{
+    namespace amqp_types_test
+    {
+
+#define QPIDIT_AMQP_TYPE_ENUM(NAME, STR) AMQP_TYPE_##NAME,
+        enum amqpType_t {
+            QPIDIT_AMQP_TYPES(QPIDIT_AMQP_TYPE_ENUM)
+            AMQP_TYPE_UNKNOWN
+        };
+#undef QPIDIT_AMQP_TYPE_ENUM
+
+        class AmqpTypes
+        {
+        public:
+            // Resolve a type name to its enum value, AMQP_TYPE_UNKNOWN if not found. Intended to be
+            // called once per test at construction, not per message.
+            static amqpType_t fromName(const std::string& amqpType) {
+#define QPIDIT_AMQP_TYPE_NAME(NAME, STR) STR,
+                static const char* const names[] = { QPIDIT_AMQP_TYPES(QPIDIT_AMQP_TYPE_NAME) };
+#undef QPIDIT_AMQP_TYPE_NAME
+                for (int i = 0; i < AMQP_TYPE_UNKNOWN; ++i) {
+                    if (amqpType.compare(names[i]) == 0) return amqpType_t(i);
+                }
+                return AMQP_TYPE_UNKNOWN;
+            }
+        };
+
+    } /* namespace amqp_types_test */
+} /* namespace qpidit */
+
+#endif /* SRC_QPIDIT_AMQP_TYPES_TEST_AMQPTYPES_HPP_ */
@@ -31,7 +31,9 @@
 #include <proton/receiver.hpp>
 #include <proton/thread_safe.hpp>
 #include <proton/transport.hpp>
+#include <qpidit/AmqpShimServer.hpp>
 #include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
@@ -42,123 +44,36 @@ namespace qpidit
                            const std::string& queueName,
                            const std::string& amqpType,
                            uint32_t expected) :
-                        _brokerUrl(brokerUrl),
-                        _queueName(queueName),
+                        AmqpReceiverBase("amqp_types_test::Receiver", brokerUrl, queueName),
                         _amqpType(amqpType),
+                        _amqpTypeId(AmqpTypes::fromName(amqpType)),
                         _expected(expected),
-                        _received(0UL),
-                        _receivedValueList(Json::arrayValue)
+                        _received(0UL)
         {}
 
         Receiver::~Receiver() {}
 
-        Json::Value& Receiver::getReceivedValueList() {
-            return _receivedValueList;
+        //static
+        qpidit::AmqpTestBase* Receiver::createJob(const std::string& brokerUrl,
+                                                  const std::string& queueName,
+                                                  const std::string& amqpType,
+                                                  const std::string& expectedStr) {
+            return new Receiver(brokerUrl, queueName, amqpType, std::strtoul(expectedStr.c_str(), NULL, 0));
         }
 
-        void Receiver::on_container_start(proton::container &c) {
-            std::ostringstream oss;
-            oss << _brokerUrl << "/" << _queueName;
-            c.open_receiver(oss.str());
+        void Receiver::printResult(std::ostream& out) {
+            printResultValues(out, _amqpType);
+            printLatency(out);
         }
 
-        void Receiver::on_message(proton::delivery &d, proton::message &m) {
+        void Receiver::processMessage(proton::delivery &d, proton::message &m) {
             try {
                 if (_received < _expected) {
-                    if (_amqpType.compare("null") == 0) {
-                        checkMessageType(m, proton::NULL_TYPE);
-                        _receivedValueList.append("None");
-                    } else if (_amqpType.compare("boolean") == 0) {
-                        checkMessageType(m, proton::BOOLEAN);
-                        _receivedValueList.append(proton::get<bool>(m.body()) ? "True": "False");
-                    } else if (_amqpType.compare("ubyte") == 0) {
-                        checkMessageType(m, proton::UBYTE);
-                        _receivedValueList.append(toHexStr<uint8_t>(proton::get<uint8_t>(m.body())));
-                    } else if (_amqpType.compare("ushort") == 0) {
-                        checkMessageType(m, proton::USHORT);
-                        _receivedValueList.append(toHexStr<uint16_t>(proton::get<uint16_t>(m.body())));
-                    } else if (_amqpType.compare("uint") == 0) {
-                        checkMessageType(m, proton::UINT);
-                        _receivedValueList.append(toHexStr<uint32_t>(proton::get<uint32_t>(m.body())));
-                    } else if (_amqpType.compare("ulong") == 0) {
-                        checkMessageType(m, proton::ULONG);
-                        _receivedValueList.append(toHexStr<uint64_t>(proton::get<uint64_t>(m.body())));
-                    } else if (_amqpType.compare("byte") == 0) {
-                        checkMessageType(m, proton::BYTE);
-                        _receivedValueList.append(toHexStr<int8_t>(proton::get<int8_t>(m.body())));
-                    } else if (_amqpType.compare("short") == 0) {
-                        checkMessageType(m, proton::SHORT);
-                        _receivedValueList.append(toHexStr<int16_t>(proton::get<int16_t>(m.body())));
-                    } else if (_amqpType.compare("int") == 0) {
-                        checkMessageType(m, proton::INT);
-                        _receivedValueList.append(toHexStr<int32_t>(proton::get<int32_t>(m.body())));
-                    } else if (_amqpType.compare("long") == 0) {
-                        checkMessageType(m, proton::LONG);
-                        _receivedValueList.append(toHexStr<int64_t>(proton::get<int64_t>(m.body())));
-                    } else if (_amqpType.compare("float") == 0) {
-                        checkMessageType(m, proton::FLOAT);
-                        float f = proton::get<float>(m.body());
-                        _receivedValueList.append(toHexStr<uint32_t>(*((uint32_t*)&f), true));
-                    } else if (_amqpType.compare("double") == 0) {
-                        checkMessageType(m, proton::DOUBLE);
-                        double d = proton::get<double>(m.body());
-                        _receivedValueList.append(toHexStr<uint64_t>(*((uint64_t*)&d), true));
-                    } else if (_amqpType.compare("decimal32") == 0) {
-                        checkMessageType(m, proton::DECIMAL32);
-                        _receivedValueList.append(byteArrayToHexStr(proton::get<proton::decimal32>(m.body())));
-                    } else if (_amqpType.compare("decimal64") == 0) {
-                        checkMessageType(m, proton::DECIMAL64);
-                        _receivedValueList.append(byteArrayToHexStr(proton::get<proton::decimal64>(m.body())));
-                    } else if (_amqpType.compare("decimal128") == 0) {
-                        checkMessageType(m, proton::DECIMAL128);
-                        _receivedValueList.append(byteArrayToHexStr(proton::get<proton::decimal128>(m.body())));
-                    } else if (_amqpType.compare("char") == 0) {
-                        checkMessageType(m, proton::CHAR);
-                        wchar_t c = proton::get<wchar_t>(m.body());
-                        std::stringstream oss;
-                        if (c < 0x7f && std::iswprint(c)) {
-                            oss << (char)c;
-                        } else {
-                            oss << "0x" << std::hex << c;
-                        }
-                        _receivedValueList.append(oss.str());
-                    } else if (_amqpType.compare("timestamp") == 0) {
-                        checkMessageType(m, proton::TIMESTAMP);
-                        std::ostringstream oss;
-                        oss << "0x" << std::hex << proton::get<proton::timestamp>(m.body()).milliseconds();
-                        _receivedValueList.append(oss.str());
-                    } else if (_amqpType.compare("uuid") == 0) {
-                        checkMessageType(m, proton::UUID);
-                        std::ostringstream oss;
-                        oss << proton::get<proton::uuid>(m.body());
-                        _receivedValueList.append(oss.str());
-                    } else if (_amqpType.compare("binary") == 0) {
-                        checkMessageType(m, proton::BINARY);
-                        _receivedValueList.append(std::string(proton::get<proton::binary>(m.body())));
-                    } else if (_amqpType.compare("string") == 0) {
-                        checkMessageType(m, proton::STRING);
-                        _receivedValueList.append(proton::get<std::string>(m.body()));
-                    } else if (_amqpType.compare("symbol") == 0) {
-                        checkMessageType(m, proton::SYMBOL);
-                        _receivedValueList.append(proton::get<proton::symbol>(m.body()));
-                    } else if (_amqpType.compare("list") == 0) {
-                        checkMessageType(m, proton::LIST);
-                        Json::Value jsonList(Json::arrayValue);
-                        _receivedValueList.append(getSequence(jsonList, m.body()));
-                    } else if (_amqpType.compare("map") == 0) {
-                        checkMessageType(m, proton::MAP);
-                        Json::Value jsonMap(Json::objectValue);
-                        _receivedValueList.append(getMap(jsonMap, m.body()));
-                    } else if (_amqpType.compare("array") == 0) {
-                        throw qpidit::UnsupportedAmqpTypeError(_amqpType);
-                    } else {
-                        throw qpidit::UnknownAmqpTypeError(_amqpType);
-                    }
+                    (this->*s_decodeFns[_amqpTypeId])(m);
                 }
                 _received++;
                 if (_received >= _expected) {
-                    d.receiver().close();
-                    d.connection().close();
+                    testComplete(d.receiver());
                 }
             } catch (const std::exception&) {
                 d.receiver().close();
@@ -167,27 +82,153 @@ namespace qpidit
             }
         }
 
-        void Receiver::on_connection_error(proton::connection &c) {
-            std::cerr << "AmqpReceiver::on_connection_error(): " << c.error() << std::endl;
+        // protected
+
+#define QPIDIT_RECEIVER_DECODE_FN(NAME, STR) &Receiver::decode##NAME,
+        //static
+        const Receiver::decodeFn_t Receiver::s_decodeFns[AMQP_TYPE_UNKNOWN + 1] = {
+            QPIDIT_AMQP_TYPES(QPIDIT_RECEIVER_DECODE_FN)
+            &Receiver::decodeUnknown
+        };
+#undef QPIDIT_RECEIVER_DECODE_FN
+
+        void Receiver::decodeNull(const proton::message& m) {
+            checkMessageType(m, proton::NULL_TYPE);
+            addResultValue(_amqpType, "None");
         }
 
-        void Receiver::on_receiver_error(proton::receiver& r) {
-            std::cerr << "AmqpReceiver::on_receiver_error(): " << r.error() << std::endl;
+        void Receiver::decodeBoolean(const proton::message& m) {
+            checkMessageType(m, proton::BOOLEAN);
+            addResultValue(_amqpType, proton::get<bool>(m.body()) ? "True": "False");
         }
 
-        void Receiver::on_session_error(proton::session &s) {
-            std::cerr << "AmqpReceiver::on_session_error(): " << s.error() << std::endl;
+        void Receiver::decodeUbyte(const proton::message& m) {
+            checkMessageType(m, proton::UBYTE);
+            addResultValue(_amqpType, toHexStr<uint8_t>(proton::get<uint8_t>(m.body())));
         }
 
-        void Receiver::on_transport_error(proton::transport &t) {
-            std::cerr << "AmqpReceiver::on_transport_error(): " << t.error() << std::endl;
+        void Receiver::decodeUshort(const proton::message& m) {
+            checkMessageType(m, proton::USHORT);
+            addResultValue(_amqpType, toHexStr<uint16_t>(proton::get<uint16_t>(m.body())));
         }
 
-        void Receiver::on_error(const proton::error_condition &ec) {
-            std::cerr << "AmqpReceiver::on_error(): " << ec << std::endl;
+        void Receiver::decodeUint(const proton::message& m) {
+            checkMessageType(m, proton::UINT);
+            addResultValue(_amqpType, toHexStr<uint32_t>(proton::get<uint32_t>(m.body())));
         }
 
-        // protected
+        void Receiver::decodeUlong(const proton::message& m) {
+            checkMessageType(m, proton::ULONG);
+            addResultValue(_amqpType, toHexStr<uint64_t>(proton::get<uint64_t>(m.body())));
+        }
+
+        void Receiver::decodeByte(const proton::message& m) {
+            checkMessageType(m, proton::BYTE);
+            addResultValue(_amqpType, toHexStr<int8_t>(proton::get<int8_t>(m.body())));
+        }
+
+        void Receiver::decodeShort(const proton::message& m) {
+            checkMessageType(m, proton::SHORT);
+            addResultValue(_amqpType, toHexStr<int16_t>(proton::get<int16_t>(m.body())));
+        }
+
+        void Receiver::decodeInt(const proton::message& m) {
+            checkMessageType(m, proton::INT);
+            addResultValue(_amqpType, toHexStr<int32_t>(proton::get<int32_t>(m.body())));
+        }
+
+        void Receiver::decodeLong(const proton::message& m) {
+            checkMessageType(m, proton::LONG);
+            addResultValue(_amqpType, toHexStr<int64_t>(proton::get<int64_t>(m.body())));
+        }
+
+        void Receiver::decodeFloat(const proton::message& m) {
+            checkMessageType(m, proton::FLOAT);
+            float f = proton::get<float>(m.body());
+            addResultValue(_amqpType, toHexStr<uint32_t>(*((uint32_t*)&f), true));
+        }
+
+        void Receiver::decodeDouble(const proton::message& m) {
+            checkMessageType(m, proton::DOUBLE);
+            double d = proton::get<double>(m.body());
+            addResultValue(_amqpType, toHexStr<uint64_t>(*((uint64_t*)&d), true));
+        }
+
+        void Receiver::decodeDecimal32(const proton::message& m) {
+            checkMessageType(m, proton::DECIMAL32);
+            addResultValue(_amqpType, byteArrayToHexStr(proton::get<proton::decimal32>(m.body())));
+        }
+
+        void Receiver::decodeDecimal64(const proton::message& m) {
+            checkMessageType(m, proton::DECIMAL64);
+            addResultValue(_amqpType, byteArrayToHexStr(proton::get<proton::decimal64>(m.body())));
+        }
+
+        void Receiver::decodeDecimal128(const proton::message& m) {
+            checkMessageType(m, proton::DECIMAL128);
+            addResultValue(_amqpType, byteArrayToHexStr(proton::get<proton::decimal128>(m.body())));
+        }
+
+        void Receiver::decodeChar(const proton::message& m) {
+            checkMessageType(m, proton::CHAR);
+            wchar_t c = proton::get<wchar_t>(m.body());
+            std::stringstream oss;
+            if (c < 0x7f && std::iswprint(c)) {
+                oss << (char)c;
+            } else {
+                oss << "0x" << std::hex << c;
+            }
+            addResultValue(_amqpType, oss.str());
+        }
+
+        void Receiver::decodeTimestamp(const proton::message& m) {
+            checkMessageType(m, proton::TIMESTAMP);
+            std::ostringstream oss;
+            oss << "0x" << std::hex << proton::get<proton::timestamp>(m.body()).milliseconds();
+            addResultValue(_amqpType, oss.str());
+        }
+
+        void Receiver::decodeUuid(const proton::message& m) {
+            checkMessageType(m, proton::UUID);
+            std::ostringstream oss;
+            oss << proton::get<proton::uuid>(m.body());
+            addResultValue(_amqpType, oss.str());
+        }
+
+        void Receiver::decodeBinary(const proton::message& m) {
+            checkMessageType(m, proton::BINARY);
+            addResultValue(_amqpType, std::string(proton::get<proton::binary>(m.body())));
+        }
+
+        void Receiver::decodeString(const proton::message& m) {
+            checkMessageType(m, proton::STRING);
+            addResultValue(_amqpType, proton::get<std::string>(m.body()));
+        }
+
+        void Receiver::decodeSymbol(const proton::message& m) {
+            checkMessageType(m, proton::SYMBOL);
+            addResultValue(_amqpType, proton::get<proton::symbol>(m.body()));
+        }
+
+        void Receiver::decodeList(const proton::message& m) {
+            checkMessageType(m, proton::LIST);
+            Json::Value jsonList(Json::arrayValue);
+            addResultValue(_amqpType, getSequence(jsonList, m.body()));
+        }
+
+        void Receiver::decodeMap(const proton::message& m) {
+            checkMessageType(m, proton::MAP);
+            Json::Value jsonMap(Json::objectValue);
+            addResultValue(_amqpType, getMap(jsonMap, m.body()));
+        }
+
+        void Receiver::decodeArray(const proton::message&) {
+            throw qpidit::UnsupportedAmqpTypeError(_amqpType);
+        }
+
+        void Receiver::decodeUnknown(const proton::message&) {
+            throw qpidit::UnknownAmqpTypeError(_amqpType);
+        }
 
         //static
         void Receiver::checkMessageType(const proton::message& msg, proton::type_id amqpType) {
@@ -270,30 +311,40 @@ namespace qpidit
 } /* namespace qpidit */
 
 
+#ifndef QPIDIT_SHIM_NO_MAIN // Defined when linked into another program, eg amqp_loopback_bench
+
 /*
  * --- main ---
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: AMQP type
  *       4: Expected number of test values to receive
+ * Options: --server: Run as a persistent shim server (see AmqpShimServer); only arg 1 is used
+ *          --latency: Record the latency of timestamped messages, printed as a third line of output
+ *          --listen: Listen on arg 1 for a sender to connect directly, rather than connecting to a broker
  */
 
 int main(int argc, char** argv) {
-    // TODO: improve arg management a little...
-    if (argc != 5) {
-        throw qpidit::ArgumentError("Incorrect number of arguments");
-    }
-
     try {
-        qpidit::amqp_types_test::Receiver receiver(argv[1], argv[2], argv[3], std::strtoul(argv[4], NULL, 0));
-        proton::container(receiver).run();
-
-        std::cout << argv[3] << std::endl;
-        Json::FastWriter fw;
-        std::cout << fw.write(receiver.getReceivedValueList());
+        qpidit::ShimArgs args(argc, argv);
+        if (args.hasOption("server")) {
+            // Arg 1 only; test jobs are read from stdin
+            qpidit::AmqpShimServer server("amqp_types_test::Receiver", args, qpidit::amqp_types_test::Receiver::createJob);
+            server.run();
+        } else {
+            if (args.numArgs() != 4) {
+                throw qpidit::ArgumentError("Incorrect number of arguments");
+            }
+            qpidit::amqp_types_test::Receiver receiver(args.arg(0), args.arg(1), args.arg(2), std::strtoul(args.arg(3).c_str(), NULL, 0));
+            receiver.setOptions(args);
+            receiver.run();
+            receiver.printResult(std::cout);
+        }
     } catch (const std::exception& e) {
         std::cerr << "AmqpReceiver error: " << e.what() << std::endl;
         exit(-1);
     }
     exit(0);
 }
+
+#endif /* QPIDIT_SHIM_NO_MAIN */
@@ -24,8 +24,9 @@
 
 #include <iomanip>
 #include <json/value.h>
-#include <proton/messaging_handler.hpp>
 #include <proton/types.hpp>
+#include <qpidit/AmqpReceiverBase.hpp>
+#include <qpidit/amqp_types_test/AmqpTypes.hpp>
 #include <sstream>
 
 namespace qpidit
@@ -33,28 +34,28 @@ namespace qpidit
     namespace amqp_types_test
     {
 
-        class Receiver : public proton::messaging_handler
+        class Receiver : public qpidit::AmqpReceiverBase
         {
         protected:
-            const std::string _brokerUrl;
-            const std::string _queueName;
+            typedef void (Receiver::*decodeFn_t)(const proton::message& m);
+            static const decodeFn_t s_decodeFns[AMQP_TYPE_UNKNOWN + 1]; // Indexed by amqpType_t
+
             const std::string _amqpType;
+            const amqpType_t _amqpTypeId; // Resolved once from _amqpType
             uint32_t _expected;
             uint32_t _received;
-            Json::Value _receivedValueList;
         public:
             Receiver(const std::string& brokerUrl, const std::string& queueName, const std::string& amqpType, uint32_t exptected);
             virtual ~Receiver();
-            Json::Value& getReceivedValueList();
-            void on_container_start(proton::container &c);
-            void on_message(proton::delivery &d, proton::message &m);
-
-            void on_connection_error(proton::connection &c);
-            void on_receiver_error(proton::receiver& r);
-            void on_session_error(proton::session &s);
-            void on_transport_error(proton::transport &t);
-            void on_error(const proton::error_condition &c);
+            static qpidit::AmqpTestBase* createJob(const std::string& brokerUrl, const std::string& queueName, const std::string& amqpType, const std::string& expectedStr);
+            void printResult(std::ostream& out);
         protected:
+            void processMessage(proton::delivery &d, proton::message &m);
+
+#define QPIDIT_RECEIVER_DECODE_DECL(NAME, STR) void decode##NAME(const proton::message& m);
+            QPIDIT_AMQP_TYPES(QPIDIT_RECEIVER_DECODE_DECL)
+#undef QPIDIT_RECEIVER_DECODE_DECL
+            void decodeUnknown(const proton::message& m);
             static void checkMessageType(const proton::message& msg, proton::type_id msgType);
             static Json::Value& getMap(Json::Value& jsonMap, const proton::value& val);
             static Json::Value& getSequence(Json::Value& jsonList, const proton::value& val);
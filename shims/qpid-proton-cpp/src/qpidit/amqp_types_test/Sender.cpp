@@ -28,6 +28,8 @@
 #include <proton/container.hpp>
 #include <proton/sender.hpp>
 #include <proton/tracker.hpp>
+#include <qpidit/AmqpShimServer.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
@@ -40,134 +42,196 @@ namespace qpidit
                        const Json::Value& testValues) :
                         AmqpSenderBase("amqp_types_test::Sender", brokerAddr, queueName, testValues.size()),
                         _amqpType(amqpType),
-                        _testValues(testValues)
-        {}
+                        _amqpTypeId(AmqpTypes::fromName(amqpType)),
+                        _messages(testValues.size())
+        {
+            // Build every message up front so that the send path only hands a ready message to proton
+            Json::Value::const_iterator itr = testValues.begin();
+            for (std::vector<proton::message>::size_type i = 0; i < _messages.size(); ++i, ++itr) {
+                setMessage(_messages[i], i + 1, *itr);
+            }
+        }
 
         Sender::~Sender() {}
 
-        void Sender::on_sendable(proton::sender &s) {
-            if (_totalMsgs == 0) {
-                s.connection().close();
-            } else if (_msgsSent == 0) {
-                for (Json::Value::const_iterator i=_testValues.begin(); i!=_testValues.end(); ++i) {
-                    if (s.credit()) {
-                        proton::message msg;
-                        s.send(setMessage(msg, *i));
-                        _msgsSent++;
-                    }
-                }
-            } else {
-                // do nothing
+        //static
+        qpidit::AmqpTestBase* Sender::createJob(const std::string& brokerAddr,
+                                                const std::string& queueName,
+                                                const std::string& amqpType,
+                                                const std::string& testValuesStr) {
+            Json::Value testValues;
+            Json::Reader jsonReader;
+            if (not jsonReader.parse(testValuesStr, testValues, false)) {
+                throw qpidit::JsonParserError(jsonReader);
             }
+            return new Sender(brokerAddr, queueName, amqpType, testValues);
         }
 
         // protected
 
-        proton::message& Sender::setMessage(proton::message& msg, const Json::Value& testValue) {
-            msg.id(_msgsSent + 1);
-            if (_amqpType.compare("null") == 0) {
-                std::string testValueStr(testValue.asString());
-                if (testValueStr.compare("None") != 0) { throw qpidit::InvalidTestValueError(_amqpType, testValueStr); }
-                proton::value v;
-                msg.body(v);
-            } else if (_amqpType.compare("boolean") == 0) {
-                std::string testValueStr(testValue.asString());
-                if (testValueStr.compare("True") == 0) {
-                    msg.body(true);
-                } else if (testValueStr.compare("False") == 0) {
-                    msg.body(false);
-                } else {
-                    throw qpidit::InvalidTestValueError(_amqpType, testValueStr);
-                }
-            } else if (_amqpType.compare("ubyte") == 0) {
-                setIntegralValue<uint8_t>(msg, testValue.asString(), true);
-            } else if (_amqpType.compare("ushort") == 0) {
-                setIntegralValue<uint16_t>(msg, testValue.asString(), true);
-            } else if (_amqpType.compare("uint") == 0) {
-                setIntegralValue<uint32_t>(msg, testValue.asString(), true);
-            } else if (_amqpType.compare("ulong") == 0) {
-                setIntegralValue<uint64_t>(msg, testValue.asString(), true);
-            } else if (_amqpType.compare("byte") == 0) {
-                setIntegralValue<int8_t>(msg, testValue.asString(), false);
-            } else if (_amqpType.compare("short") == 0) {
-                setIntegralValue<int16_t>(msg, testValue.asString(), false);
-            } else if (_amqpType.compare("int") == 0) {
-                setIntegralValue<int32_t>(msg, testValue.asString(), false);
-            } else if (_amqpType.compare("long") == 0) {
-                setIntegralValue<int64_t>(msg, testValue.asString(), false);
-            } else if (_amqpType.compare("float") == 0) {
-                setFloatValue<float, uint32_t>(msg, testValue.asString());
-            } else if (_amqpType.compare("double") == 0) {
-                setFloatValue<double, uint64_t>(msg, testValue.asString());
-            } else if (_amqpType.compare("decimal32") == 0) {
-                proton::decimal32 val;
-                hexStringToBytearray(val, testValue.asString().substr(2));
-                msg.body(val);
-            } else if (_amqpType.compare("decimal64") == 0) {
-                proton::decimal64 val;
-                hexStringToBytearray(val, testValue.asString().substr(2));
-                msg.body(val);
-            } else if (_amqpType.compare("decimal128") == 0) {
-                proton::decimal128 val;
-                hexStringToBytearray(val, testValue.asString().substr(2));
-                msg.body(val);
-            } else if (_amqpType.compare("char") == 0) {
-                std::string charStr = testValue.asString();
-                wchar_t val;
-                if (charStr.size() == 1) { // Single char "a"
-                    val = charStr[0];
-                } else if (charStr.size() >= 3 && charStr.size() <= 10) { // Format "0xN" through "0xNNNNNNNN"
-                    val = std::strtoul(charStr.data(), NULL, 16);
-                } else {
-                    //TODO throw format error
-                }
-                msg.body(val);
-            } else if (_amqpType.compare("timestamp") == 0) {
-                proton::timestamp val(std::strtoul(testValue.asString().data(), NULL, 16));
-                msg.body(val);
-            } else if (_amqpType.compare("uuid") == 0) {
-                proton::uuid val;
-                std::string uuidStr(testValue.asString());
-                // Expected format: "00000000-0000-0000-0000-000000000000"
-                //                   ^        ^    ^    ^    ^
-                //    start index -> 0        9    14   19   24
-                hexStringToBytearray(val, uuidStr.substr(0, 8), 0, 4);
-                hexStringToBytearray(val, uuidStr.substr(9, 4), 4, 2);
-                hexStringToBytearray(val, uuidStr.substr(14, 4), 6, 2);
-                hexStringToBytearray(val, uuidStr.substr(19, 4), 8, 2);
-                hexStringToBytearray(val, uuidStr.substr(24, 12), 10, 6);
-                msg.body(val);
-            } else if (_amqpType.compare("binary") == 0) {
-                //setStringValue<proton::amqp_binary>(msg, testValue.asString());
-                proton::binary val(testValue.asString());
-                msg.body(val);
-            } else if (_amqpType.compare("string") == 0) {
-                //setStringValue<proton::amqp_string>(msg, testValue.asString());
-                std::string val(testValue.asString());
-                msg.body(val);
-            } else if (_amqpType.compare("symbol") == 0) {
-                //setStringValue<proton::amqp_symbol>(msg, testValue.asString());
-                proton::symbol val(testValue.asString());
-                msg.body(val);
-            } else if (_amqpType.compare("list") == 0) {
-                std::vector<proton::value> list;
-                processList(list, testValue);
-                msg.body(list);
-            } else if (_amqpType.compare("map") == 0) {
-                std::map<std::string, proton::value> map;
-                processMap(map, testValue);
-                msg.body(map);
-            } else if (_amqpType.compare("array") == 0) {
-/*
-                std::vector<proton::value> array;
-                processArray(array, testValue);
-                msg.body(proton::as<proton::ARRAY>(array));
-*/
-                throw qpidit::UnsupportedAmqpTypeError(_amqpType);
+        proton::message& Sender::setNextMessage(proton::message&) {
+            return _messages[_msgsSent];
+        }
+
+        proton::message& Sender::setMessage(proton::message& msg, uint64_t msgId, const Json::Value& testValue) {
+            msg.id(msgId);
+            (this->*s_encodeFns[_amqpTypeId])(msg, testValue);
+            return msg;
+        }
+
+#define QPIDIT_SENDER_ENCODE_FN(NAME, STR) &Sender::encode##NAME,
+        //static
+        const Sender::encodeFn_t Sender::s_encodeFns[AMQP_TYPE_UNKNOWN + 1] = {
+            QPIDIT_AMQP_TYPES(QPIDIT_SENDER_ENCODE_FN)
+            &Sender::encodeUnknown
+        };
+#undef QPIDIT_SENDER_ENCODE_FN
+
+        void Sender::encodeNull(proton::message& msg, const Json::Value& testValue) {
+            std::string testValueStr(testValue.asString());
+            if (testValueStr.compare("None") != 0) { throw qpidit::InvalidTestValueError(_amqpType, testValueStr); }
+            proton::value v;
+            msg.body(v);
+        }
+
+        void Sender::encodeBoolean(proton::message& msg, const Json::Value& testValue) {
+            std::string testValueStr(testValue.asString());
+            if (testValueStr.compare("True") == 0) {
+                msg.body(true);
+            } else if (testValueStr.compare("False") == 0) {
+                msg.body(false);
             } else {
-                throw qpidit::UnknownAmqpTypeError(_amqpType);
+                throw qpidit::InvalidTestValueError(_amqpType, testValueStr);
             }
-            return msg;
+        }
+
+        void Sender::encodeUbyte(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<uint8_t>(msg, testValue.asString(), true);
+        }
+
+        void Sender::encodeUshort(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<uint16_t>(msg, testValue.asString(), true);
+        }
+
+        void Sender::encodeUint(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<uint32_t>(msg, testValue.asString(), true);
+        }
+
+        void Sender::encodeUlong(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<uint64_t>(msg, testValue.asString(), true);
+        }
+
+        void Sender::encodeByte(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<int8_t>(msg, testValue.asString(), false);
+        }
+
+        void Sender::encodeShort(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<int16_t>(msg, testValue.asString(), false);
+        }
+
+        void Sender::encodeInt(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<int32_t>(msg, testValue.asString(), false);
+        }
+
+        void Sender::encodeLong(proton::message& msg, const Json::Value& testValue) {
+            setIntegralValue<int64_t>(msg, testValue.asString(), false);
+        }
+
+        void Sender::encodeFloat(proton::message& msg, const Json::Value& testValue) {
+            setFloatValue<float, uint32_t>(msg, testValue.asString());
+        }
+
+        void Sender::encodeDouble(proton::message& msg, const Json::Value& testValue) {
+            setFloatValue<double, uint64_t>(msg, testValue.asString());
+        }
+
+        void Sender::encodeDecimal32(proton::message& msg, const Json::Value& testValue) {
+            proton::decimal32 val;
+            hexStringToBytearray(val, testValue.asString().substr(2));
+            msg.body(val);
+        }
+
+        void Sender::encodeDecimal64(proton::message& msg, const Json::Value& testValue) {
+            proton::decimal64 val;
+            hexStringToBytearray(val, testValue.asString().substr(2));
+            msg.body(val);
+        }
+
+        void Sender::encodeDecimal128(proton::message& msg, const Json::Value& testValue) {
+            proton::decimal128 val;
+            hexStringToBytearray(val, testValue.asString().substr(2));
+            msg.body(val);
+        }
+
+        void Sender::encodeChar(proton::message& msg, const Json::Value& testValue) {
+            std::string charStr = testValue.asString();
+            wchar_t val;
+            if (charStr.size() == 1) { // Single char "a"
+                val = charStr[0];
+            } else if (charStr.size() >= 3 && charStr.size() <= 10) { // Format "0xN" through "0xNNNNNNNN"
+                val = std::strtoul(charStr.data(), NULL, 16);
+            } else {
+                throw qpidit::InvalidTestValueError(_amqpType, charStr);
+            }
+            msg.body(val);
+        }
+
+        void Sender::encodeTimestamp(proton::message& msg, const Json::Value& testValue) {
+            proton::timestamp val(std::strtoul(testValue.asString().data(), NULL, 16));
+            msg.body(val);
+        }
+
+        void Sender::encodeUuid(proton::message& msg, const Json::Value& testValue) {
+            proton::uuid val;
+            std::string uuidStr(testValue.asString());
+            // Expected format: "00000000-0000-0000-0000-000000000000"
+            //                   ^        ^    ^    ^    ^
+            //    start index -> 0        9    14   19   24
+            hexStringToBytearray(val, uuidStr.substr(0, 8), 0, 4);
+            hexStringToBytearray(val, uuidStr.substr(9, 4), 4, 2);
+            hexStringToBytearray(val, uuidStr.substr(14, 4), 6, 2);
+            hexStringToBytearray(val, uuidStr.substr(19, 4), 8, 2);
+            hexStringToBytearray(val, uuidStr.substr(24, 12), 10, 6);
+            msg.body(val);
+        }
+
+        void Sender::encodeBinary(proton::message& msg, const Json::Value& testValue) {
+            //setStringValue<proton::amqp_binary>(msg, testValue.asString());
+            proton::binary val(testValue.asString());
+            msg.body(val);
+        }
+
+        void Sender::encodeString(proton::message& msg, const Json::Value& testValue) {
+            //setStringValue<proton::amqp_string>(msg, testValue.asString());
+            std::string val(testValue.asString());
+            msg.body(val);
+        }
+
+        void Sender::encodeSymbol(proton::message& msg, const Json::Value& testValue) {
+            //setStringValue<proton::amqp_symbol>(msg, testValue.asString());
+            proton::symbol val(testValue.asString());
+            msg.body(val);
+        }
+
+        void Sender::encodeList(proton::message& msg, const Json::Value& testValue) {
+            // Encode straight into the body; the body is cleared first as msg may be reused
+            msg.body().clear();
+            proton::codec::encoder enc(msg.body());
+            encodeJsonList(enc, testValue);
+        }
+
+        void Sender::encodeMap(proton::message& msg, const Json::Value& testValue) {
+            msg.body().clear();
+            proton::codec::encoder enc(msg.body());
+            encodeJsonMap(enc, testValue);
+        }
+
+        void Sender::encodeArray(proton::message&, const Json::Value&) {
+            throw qpidit::UnsupportedAmqpTypeError(_amqpType);
+        }
+
+        void Sender::encodeUnknown(proton::message&, const Json::Value&) {
+            throw qpidit::UnknownAmqpTypeError(_amqpType);
         }
 
         //static
@@ -181,103 +245,52 @@ namespace qpidit
         }
 
         //static
-        proton::value Sender::extractProtonValue(const Json::Value& val) {
+        void Sender::encodeJsonValue(proton::codec::encoder& enc, const Json::Value& val) {
             switch (val.type()) {
-            case Json::nullValue:
-            {
-                proton::value v; //proton::null n;
-                return v; //proton::value(n);
-            }
+            case Json::arrayValue:
+                encodeJsonList(enc, val);
+                break;
+            case Json::objectValue:
+                encodeJsonMap(enc, val);
+                break;
             case Json::intValue:
-                return proton::value(val.asInt());
+                enc << val.asInt();
+                break;
             case Json::uintValue:
-                return proton::value(val.asUInt());
+                enc << val.asUInt();
+                break;
             case Json::realValue:
-                return proton::value(val.asDouble());
+                enc << val.asDouble();
+                break;
             case Json::stringValue:
-                return proton::value(val.asString());
+                enc << val.asString();
+                break;
             case Json::booleanValue:
-                return proton::value(val.asBool());
-            default:;
+                enc << val.asBool();
+                break;
+            default: // Json::nullValue
+                enc << proton::value();
             }
         }
 
-//        //static
-//        Json::Value::ValueType getArrayType(const Json::Value& val) {
-//            if (val.size()) > 0) {
-//                return val[0].type();
-//            } else {
-//                return Json::Value::nullValue; // TODO: find a way to represent empty array
-//            }
-//        }
-
         //static
-        void Sender::processArray(std::vector<proton::value>& array, const Json::Value& testValues) {
+        void Sender::encodeJsonList(proton::codec::encoder& enc, const Json::Value& testValues) {
+            enc << proton::codec::start::list();
             for (Json::Value::const_iterator i = testValues.begin(); i != testValues.end(); ++i) {
-                if ((*i).isArray()) {
-                    std::vector<proton::value> subArray;
-                    processArray(subArray, *i);
-                    array.push_back(proton::value(subArray));
-                } else if ((*i).isObject()) {
-                    std::map<std::string, proton::value> subMap;
-                    processMap(subMap, *i);
-                    array.push_back(proton::value(subMap));
-                } else {
-                    proton::value v;
-                    if ((*i).isNull())
-                        ;
-                    else if ((*i).isBool())
-                        v = (*i).asBool();
-                    else if ((*i).isInt())
-                        v = (*i).asInt();
-                    else if ((*i).isUInt())
-                        v = (*i).asUInt();
-                    else if ((*i).isDouble())
-                        v = (*i).asDouble();
-                    else if ((*i).isString())
-                        v = (*i).asString();
-                    else
-                        ; // TODO handle this case
-                    array.push_back(v);
-                }
+                encodeJsonValue(enc, *i);
             }
+            enc << proton::codec::finish();
         }
 
         //static
-        void Sender::processList(std::vector<proton::value>& list, const Json::Value& testValues) {
+        void Sender::encodeJsonMap(proton::codec::encoder& enc, const Json::Value& testValues) {
+            // Json::Value iterates over its members in key order, as a std::map<std::string, proton::value> would
+            enc << proton::codec::start::map();
             for (Json::Value::const_iterator i = testValues.begin(); i != testValues.end(); ++i) {
-                if ((*i).isArray()) {
-                    std::vector<proton::value> subList;
-                    processList(subList, *i);
-                    list.push_back(proton::value(subList));
-                } else if ((*i).isObject()) {
-                    std::map<std::string, proton::value> subMap;
-                    processMap(subMap, *i);
-                    list.push_back(proton::value(subMap));
-                } else {
-                    list.push_back(extractProtonValue(*i));
-                }
-            }
-            //std::cout << std::endl;
-        }
-
-        //static
-        void Sender::processMap(std::map<std::string, proton::value>& map, const Json::Value& testValues) {
-            Json::Value::Members keys = testValues.getMemberNames();
-            for (std::vector<std::string>::const_iterator i=keys.begin(); i!=keys.end(); ++i) {
-                Json::Value mapVal = testValues[*i];
-                if (mapVal.isArray()) {
-                    std::vector<proton::value> subList;
-                    processList(subList, mapVal);
-                    map[*i] = subList;
-                } else if (mapVal.isObject()) {
-                    std::map<std::string, proton::value> subMap;
-                    processMap(subMap, mapVal);
-                    map[*i] = subMap;
-                } else {
-                    map[*i] = extractProtonValue(mapVal);
-                }
+                enc << i.key().asString();
+                encodeJsonValue(enc, *i);
             }
+            enc << proton::codec::finish();
         }
 
         //static
@@ -297,32 +310,42 @@ namespace qpidit
 } /* namespace qpidit */
 
 
+#ifndef QPIDIT_SHIM_NO_MAIN // Defined when linked into another program, eg amqp_loopback_bench
+
 /*
  * --- main ---
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: AMQP type
- *       4: Test value(s) as JSON string
+ *       4: Test value(s) as JSON string, "-" to read it from stdin or "@file" to read it from a file
+ * Options: --server: Run as a persistent shim server (see AmqpShimServer); only arg 1 is used
+ *          --timestamp: Annotate each message with its send time (for receiver --latency)
  */
 
 int main(int argc, char** argv) {
-    // TODO: improve arg management a little...
-    if (argc != 5) {
-        throw qpidit::ArgumentError("Incorrect number of arguments");
-    }
-
     try {
-        Json::Value testValues;
-        Json::Reader jsonReader;
-        if (not jsonReader.parse(argv[4], testValues, false)) {
-            throw qpidit::JsonParserError(jsonReader);
-        }
+        qpidit::ShimArgs args(argc, argv);
+        if (args.hasOption("server")) {
+            // Arg 1 only; test jobs are read from stdin
+            qpidit::AmqpShimServer server("amqp_types_test::Sender", args, qpidit::amqp_types_test::Sender::createJob);
+            server.run();
+        } else {
+            if (args.numArgs() != 4) {
+                throw qpidit::ArgumentError("Incorrect number of arguments");
+            }
+            Json::Value testValues;
+            args.jsonArg(3, testValues);
 
-        qpidit::amqp_types_test::Sender sender(argv[1], argv[2], argv[3], testValues);
-        proton::container(sender).run();
+            qpidit::amqp_types_test::Sender sender(args.arg(0), args.arg(1), args.arg(2), testValues);
+            sender.setOptions(args);
+            sender.run();
+            sender.printResult(std::cout);
+        }
     } catch (const std::exception& e) {
         std::cerr << "amqp_types_test Sender error: " << e.what() << std::endl;
         exit(1);
     }
     exit(0);
 }
+
+#endif /* QPIDIT_SHIM_NO_MAIN */
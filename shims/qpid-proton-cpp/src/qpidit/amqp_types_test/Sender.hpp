@@ -23,9 +23,12 @@
 #define SRC_QPIDIT_AMQP_TYPES_TEST_SENDER_HPP_
 
 #include <json/value.h>
+#include <proton/codec/encoder.hpp>
 #include <proton/message.hpp>
 #include <qpidit/AmqpSenderBase.hpp>
 #include <qpidit/QpidItErrors.hpp>
+#include <qpidit/amqp_types_test/AmqpTypes.hpp>
+#include <vector>
 
 namespace qpidit
 {
@@ -35,27 +38,36 @@ namespace qpidit
         class Sender : public qpidit::AmqpSenderBase
         {
         protected:
+            typedef void (Sender::*encodeFn_t)(proton::message& msg, const Json::Value& testValue);
+            static const encodeFn_t s_encodeFns[AMQP_TYPE_UNKNOWN + 1]; // Indexed by amqpType_t
+
             const std::string _amqpType;
-            const Json::Value _testValues;
+            const amqpType_t _amqpTypeId; // Resolved once from _amqpType
+            std::vector<proton::message> _messages; // Prebuilt from the test values, indexed by _msgsSent
 
         public:
             Sender(const std::string& brokerAddr, const std::string& queueName, const std::string& amqpType, const Json::Value& testValues);
             virtual ~Sender();
 
-            void on_sendable(proton::sender &s);
-
+            static qpidit::AmqpTestBase* createJob(const std::string& brokerAddr, const std::string& queueName, const std::string& amqpType, const std::string& testValuesStr);
         protected:
-            proton::message& setMessage(proton::message& msg, const Json::Value& testValue);
+            proton::message& setNextMessage(proton::message& msg);
+            proton::message& setMessage(proton::message& msg, uint64_t msgId, const Json::Value& testValue);
+
+#define QPIDIT_SENDER_ENCODE_DECL(NAME, STR) void encode##NAME(proton::message& msg, const Json::Value& testValue);
+            QPIDIT_AMQP_TYPES(QPIDIT_SENDER_ENCODE_DECL)
+#undef QPIDIT_SENDER_ENCODE_DECL
+            void encodeUnknown(proton::message& msg, const Json::Value& testValue);
 
             static std::string bytearrayToHexStr(const char* src, int len);
             static void revMemcpy(char* dest, const char* src, int n);
             static void uint64ToChar16(char* dest, uint64_t upper, uint64_t lower);
 
-            static proton::value extractProtonValue(const Json::Value& val);
-            //static Json::Value::ValueType getArrayType(const Json::Value& val);
-            static void processArray(std::vector<proton::value>& array, const Json::Value& testValues);
-            static void processList(std::vector<proton::value>& list, const Json::Value& testValues);
-            static void processMap(std::map<std::string, proton::value>& map, const Json::Value& testValues);
+            // Stream a JSON test value into enc: arrays become AMQP lists and objects maps with string keys,
+            // nested to any depth without building intermediate containers
+            static void encodeJsonValue(proton::codec::encoder& enc, const Json::Value& val);
+            static void encodeJsonList(proton::codec::encoder& enc, const Json::Value& testValues);
+            static void encodeJsonMap(proton::codec::encoder& enc, const Json::Value& testValues);
 
             template<size_t N> static void hexStringToBytearray(proton::byte_array<N>& ba, const std::string s, size_t fromArrayIndex = 0, size_t arrayLen = N) {
                 for (size_t i=0; i<arrayLen; ++i) {
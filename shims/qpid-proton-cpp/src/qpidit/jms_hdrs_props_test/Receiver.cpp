@@ -30,7 +30,9 @@
 #include <proton/message.hpp>
 #include <proton/thread_safe.hpp>
 #include <proton/transport.hpp>
+#include <qpidit/JavaObjectSerializer.hpp>
 #include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
@@ -153,7 +155,16 @@ namespace qpidit
         }
 
         void Receiver::receiveJmsObjectMessage(const proton::message& msg) {
-            // TODO
+            if(_jmsMessageType.compare("JMS_OBJECTMESSAGE_TYPE") != 0) {
+                throw qpidit::IncorrectMessageBodyTypeError(_jmsMessageType, "JMS_OBJECTMESSAGE_TYPE");
+            }
+            std::string subType(_subTypeList[_subTypeIndex]);
+            std::string valAsString;
+            std::string javaClassName = qpidit::JavaObjectSerializer::deserialize(proton::get<proton::binary>(msg.body()), valAsString);
+            if (subType.compare(javaClassName) != 0) {
+                throw qpidit::IncorrectMessageBodyTypeError(subType, javaClassName);
+            }
+            _receivedSubTypeList.append(Json::Value(valAsString));
         }
 
         void Receiver::receiveJmsMapMessage(const proton::message& msg) {
@@ -426,7 +437,7 @@ namespace qpidit
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: JMS message type
- *       4: JSON Test parameters containing 2 maps: [testValuesMap, flagMap]
+ *       4: JSON Test parameters containing 2 maps: [testValuesMap, flagMap] (inline, "-" or "@file")
  */
 int main(int argc, char** argv) {
     // TODO: improve arg management a little...
@@ -436,10 +447,7 @@ int main(int argc, char** argv) {
 
     try {
         Json::Value testParams;
-        Json::Reader jsonReader;
-        if (not jsonReader.parse(argv[4], testParams, false)) {
-            throw qpidit::JsonParserError(jsonReader);
-        }
+        qpidit::ShimArgs::parseJson(argv[4], testParams);
 
         qpidit::jms_hdrs_props_test::Receiver receiver(argv[1], argv[2], argv[3], testParams[0], testParams[1]);
         proton::container(receiver).run();
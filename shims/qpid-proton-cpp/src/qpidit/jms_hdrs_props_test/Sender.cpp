@@ -21,7 +21,6 @@
 
 #include "qpidit/jms_hdrs_props_test/Sender.hpp"
 
-#include <cerrno>
 #include <iomanip>
 #include <iostream>
 #include <json/json.h>
@@ -30,7 +29,7 @@
 #include <proton/thread_safe.hpp>
 #include <proton/tracker.hpp>
 #include <proton/transport.hpp>
-#include <stdio.h>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
@@ -383,24 +382,6 @@ namespace qpidit
             return msg;
         }
 
-        //static
-        proton::binary Sender::getJavaObjectBinary(const std::string& javaClassName, const std::string& valAsString) {
-            proton::binary javaObjectBinary;
-            char buf[1024];
-            int bytesRead;
-            FILE* fp = ::popen("java -cp target/JavaObjUtils.jar org.apache.qpid.interop_test.obj_util.JavaObjToBytes javaClassStr", "rb");
-            if (fp == NULL) { throw qpidit::PopenError(errno); }
-            do {
-                bytesRead = ::fread(buf, 1, sizeof(buf), fp);
-                javaObjectBinary.insert(javaObjectBinary.end(), &buf[0], &buf[bytesRead-1]);
-            } while (bytesRead == sizeof(buf));
-            int status = ::pclose(fp);
-            if (status == -1) {
-                throw qpidit::PcloseError(errno);
-            }
-            return javaObjectBinary;
-        }
-
         // static
         uint32_t Sender::getTotalNumMessages(const Json::Value& testValueMap) {
             uint32_t tot = 0;
@@ -420,7 +401,7 @@ namespace qpidit
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: AMQP type
- *       4: JSON Test parameters containing 3 maps: [testValueMap, testHeadersMap, testPropertiesMap]
+ *       4: JSON Test parameters containing 3 maps: [testValueMap, testHeadersMap, testPropertiesMap] (inline, "-" or "@file")
  */
 
 int main(int argc, char** argv) {
@@ -434,10 +415,7 @@ int main(int argc, char** argv) {
 
     try {
         Json::Value testParams;
-        Json::Reader jsonReader;
-        if (not jsonReader.parse(argv[4], testParams, false)) {
-            throw qpidit::JsonParserError(jsonReader);
-        }
+        qpidit::ShimArgs::parseJson(argv[4], testParams);
 
         qpidit::jms_hdrs_props_test::Sender sender(oss.str(), argv[3], testParams);
         proton::container(sender).run();
@@ -77,7 +77,6 @@ namespace qpidit
                 return msg;
             }
 
-            static proton::binary getJavaObjectBinary(const std::string& javaClassName, const std::string& valAsString);
             static uint32_t getTotalNumMessages(const Json::Value& testValueMap);
 
             template<typename T> static T numToBinary(T n, proton::binary& b) {
@@ -29,7 +29,9 @@
 #include <proton/message.hpp>
 #include <proton/thread_safe.hpp>
 #include <proton/transport.hpp>
+#include <qpidit/JavaObjectSerializer.hpp>
 #include <qpidit/QpidItErrors.hpp>
+#include <qpidit/ShimArgs.hpp>
 
 #include <typeinfo>
 
@@ -135,7 +137,16 @@ namespace qpidit
         }
 
         void Receiver::receiveJmsObjectMessage(const proton::message& msg) {
-            // TODO
+            if(_jmsMessageType.compare("JMS_OBJECTMESSAGE_TYPE") != 0) {
+                throw qpidit::IncorrectMessageBodyTypeError(_jmsMessageType, "JMS_OBJECTMESSAGE_TYPE");
+            }
+            std::string subType(_subTypeList[_subTypeIndex]);
+            std::string valAsString;
+            std::string javaClassName = qpidit::JavaObjectSerializer::deserialize(proton::get<proton::binary>(msg.body()), valAsString);
+            if (subType.compare(javaClassName) != 0) {
+                throw qpidit::IncorrectMessageBodyTypeError(subType, javaClassName);
+            }
+            _receivedSubTypeList.append(Json::Value(valAsString));
         }
 
         void Receiver::receiveJmsMapMessage(const proton::message& msg) {
@@ -284,23 +295,20 @@ namespace qpidit
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: JMS message type
- *       4: JSON Test parameters containing 2 maps: [testValuesMap, flagMap]
+ *       4: JSON Test parameters containing 2 maps: [testValuesMap, flagMap] (inline, "-" or "@file")
  */
 int main(int argc, char** argv) {
     try {
         // TODO: improve arg management a little...
         if (argc != 5) {
-            throw qpidit::ArgumentError("Incorrect number of arguments (expected 4):\n\t1. Broker TCP address(ip-addr:port)\n\t2. Queue name\n\t3. JMS message type\n\t4. JSON data string\n");
+            throw qpidit::ArgumentError("Incorrect number of arguments (expected 4):\n\t1. Broker TCP address(ip-addr:port)\n\t2. Queue name\n\t3. JMS message type\n\t4. JSON data string, \"-\" (stdin) or \"@file\"\n");
         }
 
         std::ostringstream oss;
         oss << argv[1] << "/" << argv[2];
 
         Json::Value testParams;
-        Json::Reader jsonReader;
-        if (not jsonReader.parse(argv[4], testParams, false)) {
-            throw qpidit::JsonParserError(jsonReader);
-        }
+        qpidit::ShimArgs::parseJson(argv[4], testParams);
 
         qpidit::jms_messages_test::Receiver receiver(oss.str(), argv[3], testParams);
         proton::container(receiver).run();
@@ -21,7 +21,6 @@
 
 #include "qpidit/jms_messages_test/Sender.hpp"
 
-#include <cerrno>
 #include <iomanip>
 #include <iostream>
 #include <json/json.h>
@@ -30,7 +29,7 @@
 #include <proton/thread_safe.hpp>
 #include <proton/tracker.hpp>
 #include <proton/transport.hpp>
-#include <stdio.h>
+#include <qpidit/ShimArgs.hpp>
 
 namespace qpidit
 {
@@ -283,24 +282,6 @@ namespace qpidit
             return msg;
         }
 
-        //static
-        proton::binary Sender::getJavaObjectBinary(const std::string& javaClassName, const std::string& valAsString) {
-            proton::binary javaObjectBinary;
-            char buf[1024];
-            int bytesRead;
-            FILE* fp = ::popen("java -cp target/JavaObjUtils.jar org.apache.qpid.interop_test.obj_util.JavaObjToBytes javaClassStr", "rb");
-            if (fp == NULL) { throw qpidit::PopenError(errno); }
-            do {
-                bytesRead = ::fread(buf, 1, sizeof(buf), fp);
-                javaObjectBinary.insert(javaObjectBinary.end(), &buf[0], &buf[bytesRead-1]);
-            } while (bytesRead == sizeof(buf));
-            int status = ::pclose(fp);
-            if (status == -1) {
-                throw qpidit::PcloseError(errno);
-            }
-            return javaObjectBinary;
-        }
-
         // static
         uint32_t Sender::getTotalNumMessages(const Json::Value& testValueMap) {
             uint32_t tot = 0;
@@ -320,24 +301,21 @@ namespace qpidit
  * Args: 1: Broker address (ip-addr:port)
  *       2: Queue name
  *       3: AMQP type
- *       4: JSON Test parameters containing 3 maps: [testValueMap, testHeadersMap, testPropertiesMap]
+ *       4: JSON Test parameters containing 3 maps: [testValueMap, testHeadersMap, testPropertiesMap] (inline, "-" or "@file")
  */
 
 int main(int argc, char** argv) {
     try {
         // TODO: improve arg management a little...
         if (argc != 5) {
-            throw qpidit::ArgumentError("Incorrect number of arguments (expected 4):\n\t1. Broker TCP address(ip-addr:port)\n\t2. Queue name\n\t3. JMS message type\n\t4. JSON data string\n");
+            throw qpidit::ArgumentError("Incorrect number of arguments (expected 4):\n\t1. Broker TCP address(ip-addr:port)\n\t2. Queue name\n\t3. JMS message type\n\t4. JSON data string, \"-\" (stdin) or \"@file\"\n");
         }
 
         std::ostringstream oss;
         oss << argv[1] << "/" << argv[2];
 
         Json::Value testParams;
-        Json::Reader jsonReader;
-        if (not jsonReader.parse(argv[4], testParams, false)) {
-            throw qpidit::JsonParserError(jsonReader);
-        }
+        qpidit::ShimArgs::parseJson(argv[4], testParams);
 
         qpidit::jms_messages_test::Sender sender(oss.str(), argv[3], testParams);
         proton::container(sender).run();
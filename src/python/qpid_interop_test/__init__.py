@@ -19,5 +19,7 @@
 
 import broker_properties
 import interop_test_errors
+import local_broker
+import parallel_test_suite
 import shims
 import test_type_map
@@ -35,6 +35,9 @@ from uuid import UUID, uuid4
 
 from proton import symbol
 import qpid_interop_test.broker_properties
+import qpid_interop_test.interop_test_errors
+import qpid_interop_test.local_broker
+import qpid_interop_test.parallel_test_suite
 import qpid_interop_test.shims
 from qpid_interop_test.test_type_map import TestTypeMap
 
@@ -329,19 +332,29 @@ class AmqpTypeTestCase(unittest.TestCase):
             queue_name = 'jms.queue.qpid-interop.amqp_types_test.%s.%s.%s' % \
                          (amqp_type, send_shim.NAME, receive_shim.NAME)
 
+            if self.peer_to_peer:
+                # The receive shim listens on a free port, and the send shim connects to it directly
+                sender_addr = receiver_addr = 'localhost:%d' % qpid_interop_test.shims.free_port()
+
             # Start the receive shim first (for queueless brokers/dispatch)
             receiver = receive_shim.create_receiver(receiver_addr, queue_name, amqp_type,
-                                                    str(len(test_value_list)))
+                                                    str(len(test_value_list)), self.peer_to_peer)
             receiver.start()
+            if self.peer_to_peer:
+                receiver.wait_listening(qpid_interop_test.shims.BASE_TIMEOUT)
 
             # Start the send shim
-            sender = send_shim.create_sender(sender_addr, queue_name, amqp_type,
-                                             dumps(test_value_list))
+            json_test_str = dumps(test_value_list)
+            sender = send_shim.create_sender(sender_addr, queue_name, amqp_type, json_test_str)
             sender.start()
 
-            # Wait for both shims to finish
-            sender.join_or_kill(qpid_interop_test.shims.THREAD_TIMEOUT)
-            receiver.join_or_kill(qpid_interop_test.shims.THREAD_TIMEOUT)
+            # Wait for both shims to finish, allowing time in proportion to the test size
+            timeout = qpid_interop_test.shims.test_timeout(len(test_value_list), len(json_test_str))
+            progress_timeout = qpid_interop_test.shims.progress_timeout()
+            sender.join_or_kill(timeout, progress_timeout)
+            # A receiver waiting for a slow sender also goes quiet, so it is only judged by its progress when the
+            # sender's progress is known too
+            receiver.join_or_kill(timeout, progress_timeout if sender.progress else None)
 
             # Process return string from sender
             send_obj = sender.get_return_object()
@@ -352,6 +365,9 @@ class AmqpTypeTestCase(unittest.TestCase):
                 else:
                     self.fail('Sender error: %s' % str(send_obj))
 
+            if receiver.latency is not None and receiver.latency['count'] > 0:
+                print 'latency (us): p50=%(p50)d p99=%(p99)d p99.9=%(p99.9)d max=%(max)d ...' % receiver.latency,
+
             # Process return string from receiver
             receive_obj = receiver.get_return_object()
             if isinstance(receive_obj, tuple):
@@ -367,6 +383,14 @@ class AmqpTypeTestCase(unittest.TestCase):
             else:
                 self.fail('Received non-tuple: %s' % str(receive_obj))
 
+def shim_product(shims, peer_to_peer):
+    """
+    Return the (send_shim, receive_shim) pairs to be tested. In peer-to-peer mode, the receive shim must be able to
+    listen for the send shim's connection.
+    """
+    return [(send_shim, receive_shim) for (send_shim, receive_shim) in product(shims, repeat=2)
+            if receive_shim.LISTEN or not peer_to_peer]
+
 def create_testcase_class(amqp_type, shim_product):
     """
     Class factory function which creates new subclasses to AmqpTypeTestCase.
@@ -403,6 +427,7 @@ def create_testcase_class(amqp_type, shim_product):
                   'amqp_type': amqp_type,
                   'sender_addr': ARGS.sender,
                   'receiver_addr': ARGS.receiver,
+                  'peer_to_peer': ARGS.peer_to_peer,
                   'test_value_list': TYPES.get_test_values(amqp_type)}
     new_class = type(class_name, (AmqpTypeTestCase,), class_dict)
     for send_shim, receive_shim in shim_product:
@@ -423,9 +448,30 @@ class TestOptions(object):
                             help='Node from which test suite will receive messages.')
         parser.add_argument('--no-skip', action='store_true',
                             help='Do not skip tests that are excluded by default for reasons of a known bug')
+        parser.add_argument('--persistent-shims', action='store_true',
+                            help='Run each test through persistent shim processes (where supported by the shim) ' +
+                            'rather than starting new shim processes for each test')
+        parser.add_argument('--latency', action='store_true',
+                            help='Report the send-to-receive latency of each test (where supported by the shims)')
+        parser.add_argument('--parallel', action='store', type=int, default=1, metavar='NUM-WORKERS',
+                            help='Run up to NUM-WORKERS tests at once, each with its own sender, receiver and ' +
+                            'queue. Cannot be combined with --persistent-shims.')
         parser.add_argument('--broker-type', action='store', metavar='BROKER_NAME',
                             help='Disable test of broker type (using connection properties) by specifying the broker' +
                             ' name, or "None".')
+        parser.add_argument('--local-broker', action='store_true',
+                            help='Start the qpid-proton-cpp local broker on a free localhost port and run the tests ' +
+                            'through it, in place of --sender and --receiver')
+        parser.add_argument('--local-broker-queue-depth', action='store', type=int, metavar='NUM-MESSAGES',
+                            help='Capacity of each --local-broker queue (the broker\'s default is 10000)')
+        parser.add_argument('--local-broker-credit-window', action='store', type=int, metavar='NUM-MESSAGES',
+                            help='Most credit the --local-broker grants each sending link (the broker\'s default ' +
+                            'is 1000)')
+        parser.add_argument('--peer-to-peer', action='store_true',
+                            help='Run each test without a broker: the receiving shim listens on a free localhost ' +
+                            'port and the sending shim connects to it directly. Only shims which can listen ' +
+                            '(currently ProtonCpp) are tested as receivers. Cannot be combined with ' +
+                            '--persistent-shims or --local-broker.')
         type_group = parser.add_mutually_exclusive_group()
         type_group.add_argument('--include-type', action='append', metavar='AMQP-TYPE',
                                 help='Name of AMQP type to include. Supported types:\n%s' %
@@ -438,6 +484,15 @@ class TestOptions(object):
         shim_group.add_argument('--exclude-shim', action='append', metavar='SHIM-NAME',
                             help='Name of shim to exclude. Supported shims: see "include-shim" above')
         self.args = parser.parse_args()
+        if self.args.parallel < 1:
+            parser.error('--parallel: NUM-WORKERS must be at least 1')
+        if self.args.parallel > 1 and self.args.persistent_shims:
+            # A persistent shim server runs one job at a time, which would serialize (or for a queueless router,
+            # deadlock) the concurrent tests
+            parser.error('--parallel cannot be combined with --persistent-shims')
+        if self.args.peer_to_peer and (self.args.persistent_shims or self.args.local_broker):
+            # Each test has its own receiver address, and there is no broker to use
+            parser.error('--peer-to-peer cannot be combined with --persistent-shims or --local-broker')
 
 
 #--- Main program start ---
@@ -499,8 +554,31 @@ if __name__ == '__main__':
                 print 'No such shim: "%s". Use --help for valid shims' % shim
                 sys.exit(1) # Errors or failures present
 
+    # Start the local broker if requested, in place of the --sender and --receiver nodes
+    LOCAL_BROKER = None
+    if ARGS.local_broker:
+        LOCAL_BROKER = qpid_interop_test.local_broker.LocalBroker(path.join(QIT_TEST_SHIM_HOME, 'qpid-proton-cpp',
+                                                                            'amqp_local_broker', 'Broker'),
+                                                                  ARGS.local_broker_queue_depth,
+                                                                  ARGS.local_broker_credit_window)
+        try:
+            ARGS.sender = ARGS.receiver = LOCAL_BROKER.start()
+        except qpid_interop_test.interop_test_errors.InteropTestError as err:
+            print err
+            sys.exit(1)
+
     # Connect to broker to find broker type, or use --broker-type param if present
-    if ARGS.broker_type is not None:
+    if ARGS.peer_to_peer:
+        BROKER = None # No broker, so no broker bugs to skip tests for
+        print 'Test Broker: None (peer-to-peer)'
+        print
+        sys.stdout.flush()
+    elif LOCAL_BROKER is not None:
+        BROKER = LOCAL_BROKER.NAME # Has no known bugs, so no tests are skipped
+        print 'Test Broker: %s on %s' % (BROKER, LOCAL_BROKER.addr)
+        print
+        sys.stdout.flush()
+    elif ARGS.broker_type is not None:
         if ARGS.broker_type == 'None':
             BROKER = None
         else:
@@ -532,10 +610,23 @@ if __name__ == '__main__':
     # Create test classes dynamically
     for at in sorted(TYPES.get_type_list()):
         if ARGS.exclude_type is None or at not in ARGS.exclude_type:
-            test_case_class = create_testcase_class(at, product(SHIM_MAP.values(), repeat=2))
+            test_case_class = create_testcase_class(at, shim_product(SHIM_MAP.values(), ARGS.peer_to_peer))
             TEST_SUITE.addTest(unittest.makeSuite(test_case_class))
 
+    for shim in SHIM_MAP.itervalues():
+        shim.set_persistent(ARGS.persistent_shims)
+        shim.set_latency(ARGS.latency)
+        shim.set_json_lines(True)
+
     # Finally, run all the dynamically created tests
-    RES = unittest.TextTestRunner(verbosity=2).run(TEST_SUITE)
+    if ARGS.parallel > 1:
+        TEST_SUITE = qpid_interop_test.parallel_test_suite.ParallelTestSuite(TEST_SUITE, ARGS.parallel)
+    try:
+        RES = unittest.TextTestRunner(verbosity=2).run(TEST_SUITE)
+    finally:
+        for shim in SHIM_MAP.itervalues():
+            shim.stop_servers()
+        if LOCAL_BROKER is not None:
+            LOCAL_BROKER.stop()
     if not RES.wasSuccessful():
         sys.exit(1) # Errors or failures present
@@ -267,9 +267,10 @@ class JmsMessageHdrsPropsTestCase(unittest.TestCase):
                                          dumps([test_values, msg_hdrs, msg_props]))
         sender.start()
 
-        # Wait for both shims to finish
-        sender.join_or_kill(qpid_interop_test.shims.THREAD_TIMEOUT)
-        receiver.join_or_kill(qpid_interop_test.shims.THREAD_TIMEOUT)
+        # Wait for both shims to finish, allowing time in proportion to the number of messages
+        timeout = qpid_interop_test.shims.test_timeout(sum(num_test_values_map.values()))
+        sender.join_or_kill(timeout)
+        receiver.join_or_kill(timeout)
 
         # Process return string from sender
         send_obj = sender.get_return_object()
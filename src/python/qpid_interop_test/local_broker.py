@@ -0,0 +1,72 @@
+"""
+Module to start and stop the qpid-proton-cpp local broker (shims/qpid-proton-cpp/amqp_local_broker), a stand-in
+for an external broker which allows the tests to be run on a host without one
+"""
+
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#
+
+from os import path
+from subprocess import Popen, PIPE
+from tempfile import TemporaryFile
+
+from qpid_interop_test.interop_test_errors import InteropTestError
+from qpid_interop_test.shims import free_port
+
+
+class LocalBroker(object):
+    """
+    Local broker process, listening on a free localhost port
+    """
+    NAME = 'qpid-interop-test-local-broker'
+
+    def __init__(self, broker_path, queue_depth=None, credit_window=None):
+        self.broker_path = broker_path
+        self.queue_depth = queue_depth # Broker default if None
+        self.credit_window = credit_window # Broker default if None
+        self.proc = None
+        self.addr = None
+
+    def start(self):
+        """Start the broker and wait until it is listening. Returns its address (ip-addr:port)"""
+        if not path.isfile(self.broker_path):
+            raise InteropTestError('Local broker not installed: %s' % self.broker_path)
+        self.addr = 'localhost:%d' % free_port()
+        arg_list = [self.broker_path]
+        if self.queue_depth is not None:
+            arg_list.append('--queue-depth=%d' % self.queue_depth)
+        if self.credit_window is not None:
+            arg_list.append('--credit-window=%d' % self.credit_window)
+        arg_list.append(self.addr)
+        errfile = TemporaryFile()
+        self.proc = Popen(arg_list, stdout=PIPE, stderr=errfile)
+        # The broker prints one line once it is listening, or exits on error (closing stdout)
+        if not self.proc.stdout.readline().startswith('Listening'):
+            self.proc.wait()
+            errfile.seek(0)
+            raise InteropTestError('Local broker failed to start on %s: %s' % (self.addr, errfile.read().strip()))
+        return self.addr
+
+    def stop(self):
+        """Stop the broker, which otherwise runs until it is killed"""
+        if self.proc is not None and self.proc.poll() is None:
+            self.proc.terminate()
+            self.proc.wait()
+        self.proc = None
+
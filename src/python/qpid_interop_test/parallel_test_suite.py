@@ -0,0 +1,105 @@
+"""
+Module containing a test suite which runs its tests concurrently on a pool of worker threads
+"""
+
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#
+
+import unittest
+
+from multiprocessing.pool import ThreadPool
+
+
+class _RecordingResult(unittest.TestResult):
+    """
+    Test result which records the calls made on it by a single test, so that they can be replayed on the real test
+    result from the main thread once the test has finished.
+    """
+    def __init__(self):
+        super(_RecordingResult, self).__init__()
+        self.events = []
+
+    def startTest(self, test):
+        self.events.append(('startTest', (test,)))
+
+    def stopTest(self, test):
+        self.events.append(('stopTest', (test,)))
+
+    def addSuccess(self, test):
+        self.events.append(('addSuccess', (test,)))
+
+    def addError(self, test, err):
+        self.events.append(('addError', (test, err)))
+
+    def addFailure(self, test, err):
+        self.events.append(('addFailure', (test, err)))
+
+    def addSkip(self, test, reason):
+        self.events.append(('addSkip', (test, reason)))
+
+    def addExpectedFailure(self, test, err):
+        self.events.append(('addExpectedFailure', (test, err)))
+
+    def addUnexpectedSuccess(self, test):
+        self.events.append(('addUnexpectedSuccess', (test,)))
+
+
+class ParallelTestSuite(unittest.TestSuite):
+    """
+    Test suite which runs the test cases of another suite on num_workers threads at once. Each test must be
+    independent of the others (eg each sender/receiver pair uses its own queue). Results are reported in the original
+    test order as each test completes, so that the output of a test runner is the same as for a sequential run.
+
+    Test cases are run individually, so class and module fixtures (setUpClass() etc.) are not supported.
+    """
+    def __init__(self, suite, num_workers):
+        super(ParallelTestSuite, self).__init__()
+        self.test_list = list(self._flatten(suite))
+        self.num_workers = num_workers
+        self.addTests(self.test_list)
+
+    def run(self, result, debug=False):
+        pool = ThreadPool(self.num_workers)
+        try:
+            for events in pool.imap(self._run_test, self.test_list):
+                for name, args in events:
+                    getattr(result, name)(*args)
+                if result.shouldStop:
+                    break
+        finally:
+            pool.terminate()
+            pool.join()
+        return result
+
+    @staticmethod
+    def _run_test(test):
+        """Run a single test on a worker thread, return the list of result events"""
+        recording_result = _RecordingResult()
+        test(recording_result)
+        return recording_result.events
+
+    @staticmethod
+    def _flatten(suite):
+        """Generate the test cases of suite, which may contain nested suites"""
+        for test in suite:
+            if isinstance(test, unittest.TestSuite):
+                for sub_test in ParallelTestSuite._flatten(test):
+                    yield sub_test
+            else:
+                yield test
@@ -20,16 +20,89 @@ Module containing worker thread classes and shims
 # under the License.
 #
 
-from json import loads
-from os import getenv, getpgid, killpg, path, setsid
+from json import dumps, loads
+import socket
+
+from os import close, fdopen, getenv, getpgid, killpg, path, pipe, setsid
 from signal import SIGKILL, SIGTERM
 from subprocess import Popen, PIPE, CalledProcessError
 from sys import stdout
-from threading import Thread
-from time import sleep
+from tempfile import TemporaryFile
+from threading import Event, Lock, Thread
+from time import sleep, time
+
+
+THREAD_TIMEOUT = 800.0 # seconds to complete before join is forced, whatever the size of the test
+BASE_TIMEOUT = 30.0 # seconds allowed for any test, to which the allowances below are added (see test_timeout())
+MESSAGE_TIMEOUT = 0.5 # seconds allowed per message
+BYTE_TIMEOUT = 5.0 / (1024 * 1024) # seconds allowed per byte of message content (5s per MiB)
+PROGRESS_TIMEOUT = 20.0 # seconds a shim reporting progress may go without doing so before it is considered hung
+JSON_STDIN_THRESHOLD = 64 * 1024 # JSON test strings larger than this are sent on stdin if the shim supports it
+
+
+def test_timeout(num_messages, num_bytes=0):
+    """Return the time (seconds) allowed for a test of num_messages messages totalling num_bytes of content"""
+    return min(THREAD_TIMEOUT, BASE_TIMEOUT + num_messages * MESSAGE_TIMEOUT + num_bytes * BYTE_TIMEOUT)
+
+
+def free_port():
+    """Return a localhost TCP port which is free now (it could be taken again before it is used)"""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    try:
+        sock.bind(('localhost', 0))
+        return sock.getsockname()[1]
+    finally:
+        sock.close()
+
+
+def progress_timeout(max_message_bytes=0):
+    """Return the time (seconds) allowed between progress reports when the largest message is max_message_bytes"""
+    return min(THREAD_TIMEOUT, PROGRESS_TIMEOUT + max_message_bytes * BYTE_TIMEOUT)
+
+
+class ShimServer(object):
+    """
+    Persistent shim process which runs successive test jobs sent to it on stdin, one JSON list
+    [queue_name, test_key, json_test_str] per line, and answers each with a JSON object {"stdout": ..., "stderr": ...}
+    on a single line of stdout. This saves the cost of a process start and broker connection per test. Jobs sent to a
+    single server are run one at a time. If the server process dies (or is killed on a timeout), it is restarted for
+    the next job.
+    """
+    def __init__(self, shim_args, broker_addr):
+        self.arg_list = list(shim_args)
+        self.arg_list.extend(['--server', broker_addr])
+        self.proc = None
+        self.errfile = None
+        self.lock = Lock()
 
+    def run_job(self, worker, queue_name, test_key, json_test_str):
+        """Run a single job on behalf of worker thread worker, return the (stdoutdata, stderrdata) tuple"""
+        with self.lock:
+            if self.proc is None or self.proc.poll() is not None:
+                self.errfile = TemporaryFile()
+                self.proc = Popen(self.arg_list, stdin=PIPE, stdout=PIPE, stderr=self.errfile, preexec_fn=setsid)
+            worker.proc = self.proc
+            try:
+                self.proc.stdin.write(dumps([queue_name, test_key, json_test_str]) + '\n')
+                self.proc.stdin.flush()
+                response_str = self.proc.stdout.readline()
+            except IOError:
+                response_str = ''
+            if len(response_str) == 0:
+                self.proc.wait()
+                self.errfile.seek(0)
+                return ('', 'Shim server %s exited (returncode=%d)\n%s' % (self.arg_list[0], self.proc.returncode,
+                                                                            self.errfile.read()))
+        response = loads(response_str)
+        return (response['stdout'].encode('utf-8'), response['stderr'].encode('utf-8'))
 
-THREAD_TIMEOUT = 800.0 # seconds to complete before join is forced
+    def stop(self):
+        """Stop the server process by closing its stdin"""
+        with self.lock:
+            if self.proc is not None and self.proc.poll() is None:
+                self.proc.stdin.close()
+                self.proc.wait()
+            self.proc = None
 
 
 class ShimWorkerThread(Thread):
@@ -38,18 +111,52 @@ class ShimWorkerThread(Thread):
         super(ShimWorkerThread, self).__init__(name=thread_name)
         self.arg_list = []
         self.return_obj = None
+        self.latency = None
         self.proc = None
+        self.progress = False # Shim reports progress on a pipe (--progress-fd)
+        self.progress_write_fd = None
+        self.last_progress = None # Time of the last progress report, None until the shim has been started
+        self.first_progress = Event() # Set at the first progress report, or when the shim closes the pipe
 
     def get_return_object(self):
         """Get the return object from the completed thread"""
         return self.return_obj
 
-    def join_or_kill(self, timeout):
+    def _set_return_object(self, stdoutdata, stderrdata):
+        """Set the return object from the shim output"""
+        if len(stderrdata) > 0:
+            self.return_obj = (stdoutdata, stderrdata)
+        else:
+            str_tvl = stdoutdata.split('\n')[0:-1] # remove trailing \n
+            if len(str_tvl) == 3: # Optional latency summary from receivers run with --latency
+                try:
+                    self.latency = loads(str_tvl[2])
+                    str_tvl = str_tvl[0:2]
+                except ValueError:
+                    pass
+            if len(str_tvl) == 2:
+                try:
+                    self.return_obj = (str_tvl[0], loads(str_tvl[1]))
+                except ValueError:
+                    self.return_obj = stdoutdata
+            else: # Make a single line of all the bits and return that
+                self.return_obj = stdoutdata
+
+    def join_or_kill(self, timeout, progress_timeout=None):
         """
-        Wait for thread to join after timeout (seconds). If still alive, it is then terminated, then if still alive,
-        killed
+        Wait for thread to join after timeout (seconds), or sooner if the shim reports progress and has not done so
+        for progress_timeout (seconds). If still alive, it is then terminated, then if still alive, killed
         """
-        self.join(timeout)
+        deadline = time() + timeout
+        while self.is_alive():
+            now = time()
+            if now >= deadline:
+                break
+            if progress_timeout is not None and self.last_progress is not None and \
+               now - self.last_progress > progress_timeout:
+                print '\n  Thread %s made no progress for %.0fs' % (self.name, now - self.last_progress),
+                break
+            self.join(min(deadline - now, 1.0))
         if self.is_alive():
             if self.proc is not None:
                 if self._terminate_pg_loop():
@@ -64,6 +171,34 @@ class ShimWorkerThread(Thread):
             else:
                 print 'ERROR: shims.join_or_kill(): Process joined and is alive, yet proc is None.'
 
+    def _progress_args(self):
+        """
+        If the shim reports progress, create the pipe it reports on and return the option giving it the write end,
+        which the child process inherits. Otherwise return an empty list.
+        """
+        if not self.progress:
+            return []
+        (read_fd, self.progress_write_fd) = pipe()
+        self.last_progress = time()
+        reader = Thread(target=self._read_progress, args=(read_fd,), name='progress_%s' % self.name)
+        reader.daemon = True
+        reader.start()
+        return ['--progress-fd=%d' % self.progress_write_fd]
+
+    def _shim_started(self):
+        """Close this process's copy of the progress pipe write end once the shim has been started"""
+        if self.progress_write_fd is not None:
+            close(self.progress_write_fd)
+            self.progress_write_fd = None
+
+    def _read_progress(self, read_fd):
+        """Progress reader thread: note the time of each progress report until the shim closes the pipe"""
+        with fdopen(read_fd) as progress_pipe:
+            for _ in iter(progress_pipe.readline, ''):
+                self.last_progress = time()
+                self.first_progress.set()
+        self.first_progress.set()
+
     def _terminate_pg_loop(self, num_attempts=2, wait_time=2):
         cnt = 0
         while cnt < num_attempts and self.is_alive():
@@ -87,35 +222,46 @@ class ShimWorkerThread(Thread):
         return self.is_alive()
 
 
+def _json_stdin_data(json_test_str, json_stdin):
+    """Return the JSON test string if it is to be sent to the shim on stdin rather than on the command-line,
+    None otherwise"""
+    if json_stdin and len(json_test_str) > JSON_STDIN_THRESHOLD:
+        return json_test_str
+    return None
+
+
 class Sender(ShimWorkerThread):
     """Sender class for multi-threaded send"""
-    def __init__(self, use_shell_flag, send_shim_args, broker_addr, queue_name, test_key, json_test_str):
+    def __init__(self, use_shell_flag, send_shim_args, broker_addr, queue_name, test_key, json_test_str,
+                 server=None, json_stdin=False, progress=False):
         super(Sender, self).__init__('sender_thread_%s' % queue_name)
         if send_shim_args is None:
             print 'ERROR: Sender: send_shim_args == None'
         self.use_shell_flag = use_shell_flag
+        self.server = server
+        self.progress = progress and server is None
+        self.job = (queue_name, test_key, json_test_str)
         self.arg_list.extend(send_shim_args)
-        self.arg_list.extend([broker_addr, queue_name, test_key, json_test_str])
+        self.stdin_data = _json_stdin_data(json_test_str, json_stdin)
+        self.arg_list.extend([broker_addr, queue_name, test_key,
+                              json_test_str if self.stdin_data is None else '-'])
 
     def run(self):
         """Thread starts here"""
         try:
             #print str('\n>>SNDR>>' + str(self.arg_list)) # DEBUG - useful to see command-line sent to shim
-            self.proc = Popen(self.arg_list, stdout=PIPE, stderr=PIPE, shell=self.use_shell_flag, preexec_fn=setsid)
-            (stdoutdata, stderrdata) = self.proc.communicate()
-            if len(stderrdata) > 0:
-                #print '<<SNDR ERROR<<', stderrdata # DEBUG - useful to see shim's failure message
-                self.return_obj = (stdoutdata, stderrdata)
+            if self.server is not None:
+                (stdoutdata, stderrdata) = self.server.run_job(self, *self.job)
             else:
-                #print '<<SNDR<<', stdoutdata # DEBUG - useful to see text received from shim
-                str_tvl = stdoutdata.split('\n')[0:-1] # remove trailing \n
-                if len(str_tvl) == 2:
-                    try:
-                        self.return_obj = (str_tvl[0], loads(str_tvl[1]))
-                    except ValueError:
-                        self.return_obj = stdoutdata
-                else: # Make a single line of all the bits and return that
-                    self.return_obj = stdoutdata
+                arg_list = self.arg_list[:1] + self._progress_args() + self.arg_list[1:]
+                try:
+                    self.proc = Popen(arg_list, stdin=None if self.stdin_data is None else PIPE, stdout=PIPE,
+                                      stderr=PIPE, shell=self.use_shell_flag, preexec_fn=setsid)
+                finally:
+                    self._shim_started()
+                (stdoutdata, stderrdata) = self.proc.communicate(self.stdin_data)
+            #print '<<SNDR<<', stdoutdata, stderrdata # DEBUG - useful to see text received from shim
+            self._set_return_object(stdoutdata, stderrdata)
         except OSError as exc:
             self.return_obj = str(exc) + ': shim=' + self.arg_list[0] 
         except CalledProcessError as exc:
@@ -124,60 +270,178 @@ class Sender(ShimWorkerThread):
 
 class Receiver(ShimWorkerThread):
     """Receiver class for multi-threaded receive"""
-    def __init__(self, receive_shim_args, broker_addr, queue_name, test_key, json_test_str):
+    def __init__(self, receive_shim_args, broker_addr, queue_name, test_key, json_test_str, server=None,
+                 json_stdin=False, json_lines=False, progress=False, listen=False):
         super(Receiver, self).__init__('receiver_thread_%s' % queue_name)
         if receive_shim_args is None:
             print 'ERROR: Receiver: receive_shim_args == None'
+        self.server = server
+        self.progress = progress and server is None
+        self.json_lines = json_lines
+        self.job = (queue_name, test_key, json_test_str)
         self.arg_list.extend(receive_shim_args)
-        self.arg_list.extend([broker_addr, queue_name, test_key, json_test_str])
+        if listen:
+            self.arg_list.insert(1, '--listen')
+        self.stdin_data = _json_stdin_data(json_test_str, json_stdin)
+        self.arg_list.extend([broker_addr, queue_name, test_key,
+                              json_test_str if self.stdin_data is None else '-'])
 
     def run(self):
         """Thread starts here"""
         try:
             #print str('\n>>RCVR>>' + str(self.arg_list)) # DEBUG - useful to see command-line sent to shim
-            self.proc = Popen(self.arg_list, stdout=PIPE, stderr=PIPE, preexec_fn=setsid)
-            (stdoutdata, stderrdata) = self.proc.communicate()
-            if len(stderrdata) > 0:
-                #print '<<RCVR ERROR<<', stderrdata # DEBUG - useful to see shim's failure message
-                self.return_obj = (stdoutdata, stderrdata)
+            if self.server is not None:
+                (stdoutdata, stderrdata) = self.server.run_job(self, *self.job)
+            elif self.json_lines:
+                self._run_json_lines()
+                return
             else:
-                #print '<<RCVR<<', stdoutdata # DEBUG - useful to see text received from shim
-                str_tvl = stdoutdata.split('\n')[0:-1] # remove trailing \n
-                if len(str_tvl) == 2:
-                    try:
-                        self.return_obj = (str_tvl[0], loads(str_tvl[1]))
-                    except ValueError:
-                        self.return_obj = stdoutdata
-                else: # Make a single line of all the bits and return that
-                    self.return_obj = stdoutdata
+                self._start_shim(PIPE)
+                (stdoutdata, stderrdata) = self.proc.communicate(self.stdin_data)
+            #print '<<RCVR<<', stdoutdata, stderrdata # DEBUG - useful to see text received from shim
+            if self.json_lines:
+                self._set_json_lines_return_object(self._read_json_lines(iter(stdoutdata.splitlines(True))),
+                                                   stderrdata)
+            else:
+                self._set_return_object(stdoutdata, stderrdata)
         except OSError as exc:
             self.return_obj = str(exc) + ': shim=' + self.arg_list[0]
         except CalledProcessError as exc:
             self.return_obj = str(exc) + '\n\n' + exc.output
 
+    def wait_listening(self, timeout):
+        """
+        Wait up to timeout (seconds) for a shim started with listen=True to start listening, which it reports as
+        its first progress. Returns early if the shim exits first.
+        """
+        self.first_progress.wait(timeout)
+
+    def _run_json_lines(self):
+        """
+        Run the shim with its --json-lines option set, and consume its result values as they are printed. If the
+        shim is killed on a timeout, the values received up to that point are returned.
+        """
+        errfile = TemporaryFile()
+        self._start_shim(errfile)
+        if self.stdin_data is not None:
+            self.proc.stdin.write(self.stdin_data)
+            self.proc.stdin.close()
+        result = self._read_json_lines(iter(self.proc.stdout.readline, ''))
+        self.proc.wait()
+        errfile.seek(0)
+        self._set_json_lines_return_object(result, errfile.read())
+
+    def _start_shim(self, stderr):
+        """Start the shim process, with stderr sent to stderr"""
+        arg_list = self.arg_list[:1] + self._progress_args() + self.arg_list[1:]
+        try:
+            self.proc = Popen(arg_list, stdin=None if self.stdin_data is None else PIPE, stdout=PIPE,
+                              stderr=stderr, preexec_fn=setsid)
+        finally:
+            self._shim_started()
+
+    def _read_json_lines(self, lines):
+        """
+        Read lines of shim output printed with the --json-lines option: the test key, then one {"value": <value>}
+        JSON object per received value, then an optional latency summary. Return the tuple (test_key, values,
+        unparsed) where unparsed is any remaining output which could not be read as JSON.
+        """
+        test_key = None
+        values = []
+        for line in lines:
+            if test_key is None:
+                test_key = line.rstrip('\n')
+                continue
+            try:
+                record = loads(line)
+            except ValueError:
+                return (test_key, values, line + ''.join(lines))
+            if isinstance(record, dict) and 'value' in record:
+                values.append(record['value'])
+            else:
+                self.latency = record
+        return (test_key, values, '')
+
+    def _set_json_lines_return_object(self, result, stderrdata):
+        """Set the return object from the result of _read_json_lines() in the same way as _set_return_object()"""
+        (test_key, values, unparsed) = result
+        if test_key is None:
+            self._set_return_object('', stderrdata)
+        elif len(unparsed) > 0 or len(stderrdata) > 0:
+            stdoutdata = '%s\n%s\n%s' % (test_key, dumps(values), unparsed)
+            self.return_obj = (stdoutdata, stderrdata) if len(stderrdata) > 0 else stdoutdata
+        else:
+            self.return_obj = (test_key, values)
+
 class Shim(object):
     """Abstract shim class, parent of all shims."""
     NAME = None
     JMS_CLIENT = False # Enables certain JMS-specific message checks
+    SERVER_MODE = False # Shim can be run as a persistent ShimServer (--server option)
+    LATENCY = False # Shim can timestamp messages (--timestamp) and report their latency (--latency)
+    JSON_STDIN = False # Shim reads the JSON test string from stdin when given "-" in its place
+    JSON_LINES = False # Shim receivers print each received value as it arrives (--json-lines)
+    PROGRESS = False # Shim reports the number of messages handled on a pipe (--progress-fd)
+    LISTEN = False # Shim receivers can listen for a sender to connect directly (--listen), requires PROGRESS
     def __init__(self, sender_shim, receiver_shim):
         self.sender_shim = sender_shim
         self.receiver_shim = receiver_shim
         self.send_params = None
         self.receive_params = None
         self.use_shell_flag = False
+        self.persistent = False
+        self.json_lines = False
+        self.servers = {}
+
+    def set_persistent(self, persistent):
+        """Run tests through persistent shim servers if the shim supports it"""
+        self.persistent = persistent and self.SERVER_MODE
+
+    def set_latency(self, latency):
+        """Have the shim senders timestamp messages and the shim receivers report latency, if supported"""
+        if latency and self.LATENCY:
+            self.send_params.insert(1, '--timestamp')
+            self.receive_params.insert(1, '--latency')
+
+    def set_json_lines(self, json_lines):
+        """Have the shim receivers print each received value as it arrives, if supported"""
+        if json_lines and self.JSON_LINES:
+            self.receive_params.insert(1, '--json-lines')
+            self.json_lines = True
+
+    def stop_servers(self):
+        """Stop any persistent shim servers"""
+        for server in self.servers.itervalues():
+            server.stop()
+        self.servers = {}
 
     def create_sender(self, broker_addr, queue_name, test_key, json_test_str):
         """Create a new sender instance"""
-        sender = Sender(self.use_shell_flag, self.send_params, broker_addr, queue_name, test_key, json_test_str)
+        sender = Sender(self.use_shell_flag, self.send_params, broker_addr, queue_name, test_key, json_test_str,
+                        self._get_server(self.send_params, broker_addr), self.JSON_STDIN, self.PROGRESS)
         sender.daemon = True
         return sender
 
-    def create_receiver(self, broker_addr, queue_name, test_key, json_test_str):
-        """Create a new receiver instance"""
-        receiver = Receiver(self.receive_params, broker_addr, queue_name, test_key, json_test_str)
+    def create_receiver(self, broker_addr, queue_name, test_key, json_test_str, listen=False):
+        """
+        Create a new receiver instance. If listen is True, the receiver listens on broker_addr for the sender to
+        connect directly (see Receiver.wait_listening()), and must only be used if LISTEN is set.
+        """
+        receiver = Receiver(self.receive_params, broker_addr, queue_name, test_key, json_test_str,
+                            None if listen else self._get_server(self.receive_params, broker_addr),
+                            self.JSON_STDIN, self.json_lines, self.PROGRESS, listen)
         receiver.daemon = True
         return receiver
 
+    def _get_server(self, shim_args, broker_addr):
+        """Return the persistent server for these shim args and broker, or None if not running persistent shims"""
+        if not self.persistent:
+            return None
+        key = (tuple(shim_args), broker_addr)
+        if key not in self.servers:
+            self.servers[key] = ShimServer(shim_args, broker_addr)
+        return self.servers[key]
+
 class ProtonPythonShim(Shim):
     """Shim for qpid-proton Python client"""
     NAME = 'ProtonPython'
@@ -190,6 +454,12 @@ class ProtonPythonShim(Shim):
 class ProtonCppShim(Shim):
     """Shim for qpid-proton C++ client"""
     NAME = 'ProtonCpp'
+    SERVER_MODE = True
+    LATENCY = True
+    JSON_STDIN = True
+    JSON_LINES = True
+    PROGRESS = True
+    LISTEN = True
     def __init__(self, sender_shim, receiver_shim):
         super(ProtonCppShim, self).__init__(sender_shim, receiver_shim)
         self.send_params = [self.sender_shim]